@@ -0,0 +1,82 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Advert payload filter
+  * Rules name the device classes that are counted: manufacturer company IDs, service UUIDs (16, 32 or 128 bit,
+  * from the UUID lists and the service data) and GAP appearance categories. An advert is counted if any of its
+  * fields matches any rule, no rules -> every advert is counted.
+  * The rule list (edited on the console, stored in NVS) is compiled into a lookup table: bitsets of the company
+  * IDs and categories plus a small UUID hash set, so the scan callback needs one pass over the raw AD structures.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum FilterRuleKind : uint8_t {
+  FILTER_COMPANY = 1,     // Manufacturer specific data company ID
+  FILTER_UUID = 2,        // Service UUID key (see filterUuidKey)
+  FILTER_APPEARANCE = 3,  // Appearance category (appearance >> 6: 1 phone, 3 watch, 0x25 wearable audio, ...)
+};
+
+struct FilterRule {
+  uint8_t kind;           // FilterRuleKind
+  uint32_t value;
+};
+
+// "company 0x004c", "uuid 180d", "uuid 0000fd6f-0000-1000-8000-00805f9b34fb", "appearance 3"
+bool filterRuleParse(const char* kind, const char* value, FilterRule* rule);
+void filterRuleFormat(const FilterRule& rule, char* text, size_t size);   // text -> at least 24 chars
+
+// 32-bit key of a service UUID. 16 and 32-bit UUIDs and 128-bit ones on the Bluetooth base UUID are their
+// 32-bit value, other 128-bit UUIDs are hashed. uuid -> little endian (as in the AD structure)
+uint32_t filterUuidKey(const uint8_t* uuid, size_t length);
+
+// Rule list as configured
+class AdvertFilterRules {
+public:
+  static const size_t CAPACITY = 32;
+
+  AdvertFilterRules() : m_count(0) {}
+
+  void clear() { m_count = 0; }
+  bool add(const FilterRule& rule);       // False if the list is full, true if the rule is already in it
+  bool remove(const FilterRule& rule);
+  size_t size() const { return m_count; }
+  const FilterRule& at(size_t index) const { return m_rules[index]; }
+
+private:
+  FilterRule m_rules[CAPACITY];
+  size_t m_count;
+};
+
+// Compiled rule table, read by the scan callback
+class AdvertFilter {
+public:
+  static const uint32_t COMPANY_IDS = 8192;   // Company IDs covered by the bitset (assigned IDs are far below)
+  static const uint32_t CATEGORIES = 1024;    // Appearance categories (10 bits)
+
+  AdvertFilter() { compile(AdvertFilterRules()); }
+
+  void compile(const AdvertFilterRules& rules);
+
+  bool enabled() const { return m_kinds != 0; }
+  // True if the advert belongs to a counted device class (or there are no rules)
+  bool matches(const uint8_t* payload, size_t length) const;
+
+private:
+  static const size_t UUID_SLOTS = 64;        // Power of two, twice the rule capacity
+
+  bool hasCompany(uint32_t id) const { return id < COMPANY_IDS && (m_companies[id >> 5] >> (id & 31)) & 1; }
+  bool hasUuid(uint32_t key) const;
+
+  uint32_t m_companies[COMPANY_IDS / 32];
+  uint32_t m_categories[CATEGORIES / 32];
+  uint32_t m_uuids[UUID_SLOTS];               // Open addressing, 0 -> free
+  uint8_t m_kinds;                            // Bit (1 << FilterRuleKind) of every kind with a rule
+};
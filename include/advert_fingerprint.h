@@ -0,0 +1,31 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Advert payload fingerprint
+  * One pass over the raw AD structures hashes the parts of an advert that stay the same when a phone
+  * rotates its random address (flags, service UUIDs, TX power, appearance, name, manufacturer ID and
+  * message type). Rotating fields such as the rest of the manufacturer data are left out.
+  * The same pass picks up the TX power level and the appearance for the RSSI correction.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "rssi_filter.h"
+
+struct AdvertInfo {
+  uint32_t fingerprint;   // 0 -> nothing usable in the payload
+  int8_t txPower;         // TX power level (dBm), TX_POWER_UNKNOWN if not advertised
+  uint16_t appearance;    // GAP appearance, 0 -> unknown
+};
+
+void advertParse(const uint8_t* payload, size_t length, AdvertInfo* info);
+
+// Typical TX power (dBm) of the class of an appearance, TX_POWER_UNKNOWN if there is no default for it
+int8_t advertClassTxPower(uint16_t appearance);
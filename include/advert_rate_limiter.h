@@ -0,0 +1,40 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Host-side per-MAC advert rate limiter
+  * Lets at most one advert per address through every interval, so a phone advertising many times
+  * a second still delivers a periodic RSSI update without flooding the rest of the pipeline.
+  * Direct-mapped cache: O(1), fixed memory, a collision only means one extra advert gets through.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "allowlist.h"
+
+class AdvertRateLimiter {
+public:
+  static const size_t SLOTS = 256;    // Power of two
+
+  AdvertRateLimiter();
+
+  void setInterval(uint32_t intervalMs) { m_intervalMs = intervalMs; }   // 0 -> let everything through
+  void clear();
+
+  // True if the advert should be processed, false if the address was forwarded too recently
+  bool allow(MacKey address, uint32_t nowMs);
+
+  uint32_t suppressed() const { return m_suppressed; }
+
+private:
+  MacKey m_addresses[SLOTS];
+  uint32_t m_forwardedMs[SLOTS];
+  uint32_t m_intervalMs;
+  uint32_t m_suppressed;
+};
@@ -0,0 +1,49 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Advert trace format
+  * Recorded scan results as a byte stream, so a venue can be replayed on the host (src/bench).
+  * File: "BLET" + version byte, then one record per advert:
+  *   [time ms:4][address:6][address type:1][rssi:1][flags:1][payload length:1][payload]  (little endian)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "scanner.h"
+
+static const uint8_t TRACE_MAGIC[4] = { 'B', 'L', 'E', 'T' };
+static const uint8_t TRACE_VERSION = 1;
+static const size_t TRACE_HEADER_SIZE = 5;
+static const size_t TRACE_PAYLOAD_MAX = 62;        // Advert + scan response
+static const size_t TRACE_RECORD_HEADER_SIZE = 14;
+static const size_t TRACE_RECORD_MAX = TRACE_RECORD_HEADER_SIZE + TRACE_PAYLOAD_MAX;
+
+static const uint8_t TRACE_FLAG_SCAN_RESPONSE = 0x01;
+
+struct TraceRecord {
+  uint32_t timeMs;
+  uint8_t address[6];
+  uint8_t addressType;
+  int8_t rssi;
+  uint8_t flags;
+  uint8_t payloadLength;
+  uint8_t payload[TRACE_PAYLOAD_MAX];
+};
+
+size_t traceWriteHeader(uint8_t* out);                       // out -> TRACE_HEADER_SIZE bytes
+bool traceCheckHeader(const uint8_t* data, size_t length);
+
+// Returns the bytes written (out -> TRACE_RECORD_MAX bytes), payload false -> record without the payload
+size_t traceEncode(const ScanResult& result, uint32_t timeMs, bool payload, uint8_t* out);
+// Returns the bytes consumed, 0 if the data ends in the middle of a record
+size_t traceDecode(const uint8_t* data, size_t length, TraceRecord* record);
+
+// View of a decoded record as the scanner backends report it, valid as long as the record
+ScanResult traceScanResult(const TraceRecord& record);
@@ -0,0 +1,48 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Known BLE device allowlist
+  * MAC addresses are parsed once into packed 48-bit keys and stored in a fixed open-addressing hash table,
+  * so a scan result can be checked straight from the raw address bytes without building any strings.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 48-bit MAC address packed into the low 6 bytes (first address byte is the most significant)
+typedef uint64_t MacKey;
+
+MacKey macKeyFromBytes(const uint8_t* mac);               // mac -> 6 raw address bytes
+void macKeyToBytes(MacKey key, uint8_t* mac);
+bool macKeyFromString(const char* text, MacKey* key);     // "aa:bb:cc:dd:ee:ff" (case insensitive)
+void macKeyToString(MacKey key, char* text);              // text -> at least 18 chars
+
+class Allowlist {
+public:
+  static const size_t CAPACITY = 64;  // Maximum number of known devices
+
+  Allowlist();
+
+  void clear();
+  bool add(MacKey key);               // False if the table is full
+  bool remove(MacKey key);
+  bool contains(MacKey key) const;
+  size_t size() const { return m_count; }
+
+  // Copy all keys out (e.g. to persist them), returns the number of keys written
+  size_t copyTo(MacKey* keys, size_t maxKeys) const;
+
+private:
+  static const size_t SLOTS = 128;    // Power of two, keeps the load factor at or below 0.5
+
+  size_t findSlot(MacKey key) const;
+
+  MacKey m_slots[SLOTS];
+  size_t m_count;
+};
@@ -0,0 +1,18 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Persistent storage of the known device allowlist in NVS
+  * Entries are kept as one blob of raw 6-byte addresses so new devices can be added without reflashing.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include "allowlist.h"
+
+bool allowlistLoad(Allowlist& list);        // False if nothing is stored yet
+bool allowlistSave(const Allowlist& list);
+void allowlistErase();
@@ -0,0 +1,63 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Audience estimator
+  * Everything between a classified advert and the I2C mode byte: rotating address merging, presence table
+  * and the audience mode state machine. No Arduino or BLE headers, so both the sketch and the host replay
+  * benchmark run exactly this code.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "audience_mode.h"
+#include "bloom_filter.h"
+#include "device_record.h"
+#include "mesh_table.h"
+#include "occupancy_trend.h"
+#include "presence_table.h"
+#include "scanner_config.h"
+
+class AudienceEstimator {
+public:
+  AudienceEstimator();
+
+  // Radius, RSSI filter, rotation and mode settings, can be called again at runtime
+  void configure(const ScannerConfig& config);
+
+  // Count one advert of an unknown device, isNew is set for the first advert of a device
+  void add(const DeviceRecord& record, bool* isNew);
+
+  // Once per aggregation pass => age out devices, decide the mode, true if the mode changed
+  bool update(uint32_t nowMs);
+
+  // Head of a multi-scanner room => counts and mode follow the merged table of all nodes, nullptr -> local
+  void useMerged(const MeshTable* merged) { m_merged = merged; }
+
+  // Devices inside of the normal / footstep radius
+  int count() const { return m_merged ? m_merged->count() : m_presence.count(); }
+  int countFootstep() const { return m_merged ? m_merged->countFootstep() : m_presence.countFootstep(); }
+  AudienceLevel level() const { return m_mode.level(); }
+  char message() const { return m_mode.message(); }
+
+  const PresenceTable& presence() const { return m_presence; }
+  const AudienceMode& mode() const { return m_mode; }
+  const OccupancyTrend& trend() const { return m_trend; }   // Arrival / departure rate and dwell of the local audience
+
+private:
+  PresenceTable m_presence;
+  RotatingBloomFilter<4096> m_retired;   // Addresses a device rotated away from
+  AudienceMode m_mode;
+  OccupancyTrend m_trend;
+  const MeshTable* m_merged;
+
+  uint16_t m_rotationMinGap;
+  uint8_t m_rotationRssiTolerance;
+  uint32_t m_retiredMemory;
+  uint32_t m_retiredRotateMs;
+};
@@ -0,0 +1,59 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Audience mode state machine
+  * The device count is mapped onto audience levels (none, few, small, large) with separate enter and
+  * exit thresholds and a minimum dwell time per level, so a count hovering around a boundary no
+  * longer makes the mode (and the Teensy pattern) toggle on every pass.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+enum AudienceLevel {
+  AUDIENCE_NONE = 0,
+  AUDIENCE_FEW,
+  AUDIENCE_SMALL,
+  AUDIENCE_LARGE,
+  AUDIENCE_LEVELS
+};
+
+struct AudienceThreshold {
+  uint16_t enter;   // Count at or above which the level is entered from below
+  uint16_t exit;    // Count below which the level is left downwards (<= enter)
+};
+
+struct AudienceModeConfig {
+  AudienceThreshold thresholds[AUDIENCE_LEVELS - 1];  // Boundaries of AUDIENCE_FEW, _SMALL and _LARGE
+  uint32_t dwellMs[AUDIENCE_LEVELS];                   // Minimum time in a level before it may be left
+  char messages[AUDIENCE_LEVELS];                      // I2C mode byte of every level
+};
+
+class AudienceMode {
+public:
+  AudienceMode();
+
+  // Can be called at any time, the current level is kept and re-evaluated on the next update()
+  void configure(const AudienceModeConfig& config);
+  const AudienceModeConfig& config() const { return m_config; }
+
+  // Once per aggregation pass with the number of devices in range, true if the level changed
+  bool update(uint32_t nowMs, int count);
+
+  AudienceLevel level() const { return m_level; }
+  char message() const { return m_config.messages[m_level]; }
+  uint32_t transitions() const { return m_transitions; }
+
+private:
+  AudienceLevel targetLevel(int count) const;
+
+  AudienceModeConfig m_config;
+  AudienceLevel m_level;
+  uint32_t m_enteredMs;
+  uint32_t m_transitions;
+};
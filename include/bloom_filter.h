@@ -0,0 +1,79 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Rotating Bloom filter of recently retired MAC addresses
+  * Two generations of BITS bits each. rotate() drops the older generation, so an address is remembered
+  * for one to two rotation periods and memory never grows.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "allowlist.h"
+
+template <size_t BITS>
+class RotatingBloomFilter {
+  static_assert(BITS >= 64 && (BITS & (BITS - 1)) == 0, "RotatingBloomFilter size must be a power of two");
+
+public:
+  RotatingBloomFilter() : m_current(0), m_count(0) { clear(); }
+
+  void clear() {
+    memset(m_bits, 0, sizeof(m_bits));
+    m_count = 0;
+  }
+
+  void add(MacKey address) {
+    uint32_t* bits = m_bits[m_current];
+    for (int i = 0; i < HASHES; i++) {
+      uint32_t bit = hash(address, i);
+      bits[bit >> 5] |= (1u << (bit & 31));
+    }
+    m_count++;
+  }
+
+  bool contains(MacKey address) const {
+    return containsIn(m_bits[0], address) || containsIn(m_bits[1], address);
+  }
+
+  // Start a new generation, forgetting the addresses added two rotations ago
+  void rotate() {
+    m_current ^= 1;
+    memset(m_bits[m_current], 0, sizeof(m_bits[m_current]));
+    m_count = 0;
+  }
+
+  size_t count() const { return m_count; }   // Addresses added to the current generation
+
+private:
+  static const int HASHES = 3;
+
+  // Double hashing from one 64-bit multiplicative hash
+  static uint32_t hash(MacKey address, int i) {
+    uint64_t h = address * 0x9E3779B97F4A7C15ULL;
+    uint32_t h1 = (uint32_t)(h >> 32);
+    uint32_t h2 = (uint32_t)h | 1;
+    return (h1 + (uint32_t)i * h2) & (BITS - 1);
+  }
+
+  static bool containsIn(const uint32_t* bits, MacKey address) {
+    for (int i = 0; i < HASHES; i++) {
+      uint32_t bit = hash(address, i);
+      if ((bits[bit >> 5] & (1u << (bit & 31))) == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  uint32_t m_bits[2][BITS / 32];
+  uint8_t m_current;
+  size_t m_count;
+};
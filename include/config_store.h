@@ -0,0 +1,18 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Persistent storage of the scanner configuration in NVS
+  * The whole ScannerConfig is one blob, so the boot path is a single read with no text parsing.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include "scanner_config.h"
+
+bool configLoad(ScannerConfig& config);     // False if nothing valid is stored, config is left unchanged
+bool configSave(const ScannerConfig& config);
+void configErase();
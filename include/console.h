@@ -0,0 +1,55 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Serial command console
+  * Reads the configuration, the allowlist and the advert filter rules and changes them without a restart:
+  *   get [field] | set <field> <value> | defaults | save | allow [add|remove <mac>] |
+  *   filter [add|remove <company|uuid|appearance> <value> | clear] | calibrate | stats [reset] | trace start|stop|dump | help
+  * Lines are assembled without blocking, a command only runs once its newline arrived.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "advert_filter.h"
+#include "allowlist.h"
+#include "scanner_config.h"
+
+// What a command changed, the owner applies it
+enum ConsoleChange {
+  CONSOLE_NONE = 0x00,
+  CONSOLE_CONFIG = 0x01,
+  CONSOLE_ALLOWLIST = 0x02,
+  CONSOLE_CALIBRATE = 0x04,
+  CONSOLE_STATS = 0x08,         // Print the telemetry report
+  CONSOLE_STATS_RESET = 0x10,   // Clear the timing statistics
+  CONSOLE_TRACE_START = 0x20,   // Advert trace recording (see trace_recorder.h)
+  CONSOLE_TRACE_STOP = 0x40,
+  CONSOLE_TRACE_DUMP = 0x80,
+  CONSOLE_FILTER = 0x100        // Advert filter rules (see advert_filter.h)
+};
+
+class Console {
+public:
+  Console(ScannerConfig& config, Allowlist& allowlist, AdvertFilterRules& filterRules);
+
+  // Execute every complete line waiting on the stream, returns the ConsoleChange bits
+  uint16_t poll(Stream& stream);
+
+private:
+  static const size_t LINE_SIZE = 64;
+
+  uint16_t execute(char* line, Print& out);
+  void printField(Print& out, size_t field);
+
+  ScannerConfig& m_config;
+  Allowlist& m_allowlist;
+  AdvertFilterRules& m_filterRules;
+  char m_line[LINE_SIZE];
+  size_t m_length;
+};
@@ -0,0 +1,35 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Compact record of a scanned BLE device
+  * The known/unknown classification is computed once in the scan callback and kept next to the result.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "allowlist.h"
+#include "scanner.h"
+
+// Address type of a random (static or private) address, the same value in Bluedroid and NimBLE
+static const uint8_t ADDRESS_TYPE_RANDOM = 1;
+
+struct DeviceRecord {
+  MacKey address;   // Packed MAC address
+  uint32_t timeMs;  // millis() when the advert was received
+  int8_t rssi;      // RSSI in dBm
+  bool known;       // True -> Device is in the known device allowlist
+  uint8_t addressType;  // BLE_ADDR_TYPE_xxx (public, random, ...)
+  uint32_t fingerprint; // Stable advert payload fields (see advert_fingerprint.h), 0 -> unknown or scan response
+  int8_t txPower;       // Advertised or class default TX power (dBm), TX_POWER_UNKNOWN if neither
+  uint8_t txSource;     // TxPowerSource of txPower
+};
+
+// Fill a record from a scan result (payload parsed for the fingerprint and the TX power)
+void deviceRecordFill(DeviceRecord& record, const ScanResult& result, MacKey address, bool known, uint32_t nowMs);
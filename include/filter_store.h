@@ -0,0 +1,17 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Persistent storage of the advert filter rules in NVS
+  * One blob of 5-byte rules ([kind][value, little endian]), compiled into the AdvertFilter table on load.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include "advert_filter.h"
+
+bool filterRulesLoad(AdvertFilterRules& rules);      // False if nothing is stored yet
+bool filterRulesSave(const AdvertFilterRules& rules);
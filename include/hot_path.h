@@ -0,0 +1,23 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Hot path placement
+  * SCANNER_HOT marks the functions on the scan callback and I2C callback path. With -DSCANNER_HOT_IRAM=1
+  * (env:release-fast) the marked functions are placed in IRAM, so their own code never waits on a flash cache
+  * miss. What they call is not covered: templates and inline functions the compiler does not inline (TripleBuffer,
+  * RingBuffer), const tables in .rodata (CRC, UUID base), the BLE stack, Wire and the Arduino core stay in flash.
+  * Everywhere else (and on the host build) the mark is empty.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#if SCANNER_HOT_IRAM && defined(ESP_PLATFORM)
+#include <esp_attr.h>
+#define SCANNER_HOT IRAM_ATTR
+#else
+#define SCANNER_HOT
+#endif
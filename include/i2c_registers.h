@@ -0,0 +1,95 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Register-addressed I2C slave protocol
+  * The master writes the register number first. A write of only that byte selects what the next read
+  * returns, more bytes are a write to the register (and select it for reading the result). A selection holds
+  * for one read, after it every read returns the status frame again until the next selection, so a master
+  * that only ever reads keeps working next to one that edits the config.
+  *
+  *   0x00 STATUS     read  status frame (status_frame.h)
+  *   0x01 TELEMETRY  read  telemetry frame (telemetry.h), refreshed once a second
+  *   0x02 CONFIG     write [field]           select a config field (index of the named field table)
+  *                   write [field][value:4]  set the field (validated, applied live, boot fields after a restart)
+  *                   read  [field][value:4][result][crc]
+  *   0x03 ALLOWLIST  write [op][mac:6]       op: 1 add, 2 remove (mac: first address byte first)
+  *                   write [3]               clear
+  *                   read  [known devices:2][capacity:2][result][crc]
+  *   0x04 COMMAND    write [command]         1 save config + allowlist + filter, 2 defaults, 3 calibrate
+  * All values little endian, CRC-8 as in the status frame over the bytes before it. result is the outcome
+  * of the last config / allowlist / command write (I2C_RESULT_*).
+  * Reads are served from published snapshots, writes are queued and applied by the aggregation task,
+  * so an I2C transaction never waits on the scan or aggregation task.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#include "advert_filter.h"
+#include "allowlist.h"
+#include "ring_buffer.h"
+#include "scanner_config.h"
+
+enum I2cRegister {
+  REG_STATUS = 0x00,
+  REG_TELEMETRY = 0x01,
+  REG_CONFIG = 0x02,
+  REG_ALLOWLIST = 0x03,
+  REG_COMMAND = 0x04
+};
+
+enum I2cResult {
+  I2C_RESULT_NONE = 0,      // No write yet
+  I2C_RESULT_OK = 1,
+  I2C_RESULT_PENDING = 2,   // Queued, not applied yet
+  I2C_RESULT_INVALID = 3,   // Unknown field / op / command or value out of range
+  I2C_RESULT_FAILED = 4     // Allowlist full, NVS write failed
+};
+
+static const size_t I2C_CONFIG_FRAME_SIZE = 7;
+static const size_t I2C_ALLOWLIST_FRAME_SIZE = 6;
+
+class I2cRegisters {
+public:
+  static const size_t WRITE_MAX = 8;   // Register byte + the longest write (allowlist)
+
+  I2cRegisters(ScannerConfig& config, Allowlist& allowlist, const AdvertFilterRules& filterRules);
+
+  // Wire receive callback context => select the register, queue a write
+  void receive(const uint8_t* data, size_t length);
+  uint8_t selected() const { return m_register.load(std::memory_order_relaxed); }
+  // Wire request callback context => the read of the selection is done, back to the status frame
+  void served() { m_register.store(REG_STATUS, std::memory_order_relaxed); }
+
+  // Wire request callback context, frames of the registers that are not published elsewhere
+  size_t encodeConfig(const ScannerConfig& snapshot, uint8_t* frame) const;
+  size_t encodeAllowlist(uint16_t knownDevices, uint8_t* frame) const;
+
+  // Aggregation task => apply the queued writes, returns the ConsoleChange bits (see console.h)
+  uint16_t poll();
+
+  uint32_t dropped() const { return m_writes.dropped(); }   // Writes lost because the queue was full
+
+private:
+  struct Write {
+    uint8_t length;
+    uint8_t data[WRITE_MAX];
+  };
+
+  uint16_t execute(const Write& write);
+
+  ScannerConfig& m_config;
+  Allowlist& m_allowlist;
+  const AdvertFilterRules& m_filterRules;   // Only saved, the rules are edited on the console
+  RingBuffer<Write, 8> m_writes;
+  std::atomic<uint8_t> m_register;
+  std::atomic<uint8_t> m_field;
+  std::atomic<uint8_t> m_result;
+};
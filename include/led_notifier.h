@@ -0,0 +1,22 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Non-blocking LED notification
+  * The blink pattern (one blink per counted device) is rendered by an esp_timer callback,
+  * so showing it costs the caller nothing and never delays counting or the scan.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+void ledNotifierBegin(int greenPin, int redPin, uint32_t blinkMs);
+
+// Blink green greenBlinks times, then red redBlinks times. Replaces a pattern that is still running
+void ledNotifierShow(int greenBlinks, int redBlinks);
+
+bool ledNotifierBusy();
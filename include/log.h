@@ -0,0 +1,63 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Compile-time log levels for the serial output
+  * Select the level per PlatformIO environment with -DSCANNER_LOG_LEVEL=LOG_LEVEL_xxx.
+  * Messages above the selected level compile to nothing, arguments included.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+#define LOG_LEVEL_NONE    0
+#define LOG_LEVEL_ERROR   1
+#define LOG_LEVEL_WARN    2
+#define LOG_LEVEL_INFO    3   // Periodic audience reports
+#define LOG_LEVEL_DEBUG   4   // Every new device
+#define LOG_LEVEL_VERBOSE 5   // Every advert
+
+#ifndef SCANNER_LOG_LEVEL
+#define SCANNER_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_PRINT(format, ...) Serial.printf(format "\n", ##__VA_ARGS__)
+// Compiled out, but the arguments stay referenced (no unused variable warnings) and are never evaluated
+#define LOG_NOTHING(format, ...) do { if (0) LOG_PRINT(format, ##__VA_ARGS__); } while (0)
+
+#if SCANNER_LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(format, ...) LOG_PRINT("[E] " format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...) LOG_NOTHING(format, ##__VA_ARGS__)
+#endif
+
+#if SCANNER_LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(format, ...) LOG_PRINT("[W] " format, ##__VA_ARGS__)
+#else
+#define LOG_WARN(format, ...) LOG_NOTHING(format, ##__VA_ARGS__)
+#endif
+
+#if SCANNER_LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(format, ...) LOG_PRINT(format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...) LOG_NOTHING(format, ##__VA_ARGS__)
+#endif
+
+#if SCANNER_LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(format, ...) LOG_PRINT(format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) LOG_NOTHING(format, ##__VA_ARGS__)
+#endif
+
+#if SCANNER_LOG_LEVEL >= LOG_LEVEL_VERBOSE
+#define LOG_VERBOSE(format, ...) LOG_PRINT(format, ##__VA_ARGS__)
+#else
+#define LOG_VERBOSE(format, ...) LOG_NOTHING(format, ##__VA_ARGS__)
+#endif
+
+// True if messages of this level are compiled in (guards for code that only builds log text)
+#define LOG_ENABLED(level) (SCANNER_LOG_LEVEL >= (level))
@@ -0,0 +1,31 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * ESP-NOW link between the scanner nodes of one room
+  * Broadcast on a fixed WiFi channel, no access point and no pairing. Received messages are copied from
+  * the WiFi task into a lock-free queue and merged by the aggregation task.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mesh_protocol.h"
+
+struct MeshPacket {
+  uint8_t length;
+  uint8_t data[MESH_MESSAGE_MAX];
+};
+
+// Start ESP-NOW on channel (1..13), receive -> queue the messages of the other nodes (head node)
+bool meshLinkBegin(uint8_t channel, bool receive);
+
+bool meshLinkSend(const uint8_t* data, size_t length);   // Broadcast, never waits for the air
+bool meshLinkReceive(MeshPacket& packet);                // Next queued message, false if none
+
+uint32_t meshLinkDropped();   // Received messages lost because the queue was full
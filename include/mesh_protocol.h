@@ -0,0 +1,49 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Multi-scanner message format (ESP-NOW broadcast between the scanner nodes of one room)
+  * A scanner node reports the devices it tracks to the head node, one message is a batch of reports:
+  *   [0] MESH_VERSION  [1] node id  [2] sequence  [3] report count
+  *   then per device [address hash:4][smoothed RSSI dBm:1][time since last seen, 100 ms units:1] (little endian)
+  * Only devices that are new, moved by the RSSI step or are due for a refresh are sent (see mesh_summary.h),
+  * the last-seen time is relative to the send time, so the nodes need no common clock.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "allowlist.h"
+
+enum MeshRole {
+  MESH_OFF = 0,    // Single scanner
+  MESH_NODE = 1,   // Reports its devices to the head, does not serve the Teensy
+  MESH_HEAD = 2    // Merges the reports of all nodes (and its own), alone serves the Teensy
+};
+
+static const uint8_t MESH_VERSION = 1;
+static const size_t MESH_MESSAGE_MAX = 250;   // ESP-NOW payload limit
+static const size_t MESH_HEADER_SIZE = 4;
+static const size_t MESH_REPORT_SIZE = 6;
+static const size_t MESH_REPORTS_MAX = (MESH_MESSAGE_MAX - MESH_HEADER_SIZE) / MESH_REPORT_SIZE;
+static const uint32_t MESH_AGE_UNIT_MS = 100;
+static const uint8_t MESH_AGE_MAX = 255;      // Saturates, older devices are reported as 25.5 s ago
+
+struct MeshReport {
+  uint32_t hash;     // meshAddressHash() of the device address
+  int8_t rssi;       // Smoothed, TX power corrected RSSI (dBm) at the reporting node
+  uint8_t age;       // Time since the node last heard the device (MESH_AGE_UNIT_MS units)
+};
+
+// 32-bit address hash, the same device hashes the same on every node
+uint32_t meshAddressHash(MacKey address);
+
+// Returns the message length (out -> MESH_MESSAGE_MAX bytes), count <= MESH_REPORTS_MAX
+size_t meshEncode(uint8_t node, uint8_t sequence, const MeshReport* reports, size_t count, uint8_t* out);
+// Returns the number of reports (reports -> MESH_REPORTS_MAX), 0 for an empty or invalid message
+size_t meshDecode(const uint8_t* data, size_t length, uint8_t* node, MeshReport* reports);
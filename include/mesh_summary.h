@@ -0,0 +1,48 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Multi-scanner reports of one node
+  * Turns the local presence table into report messages (see mesh_protocol.h). A device is only reported
+  * when it is new, its smoothed RSSI moved by rssiStep or its last report is refreshMs old, so a crowd
+  * standing still costs one report per device and refresh period. The last report of every table entry
+  * is kept by entry index, no search.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mesh_protocol.h"
+#include "presence_table.h"
+
+class MeshSummarizer {
+public:
+  MeshSummarizer();
+
+  // refreshMs -> report an unchanged device this often (below the head TTL), rssiStep -> dB change worth a report
+  void configure(uint32_t refreshMs, uint8_t rssiStep);
+
+  // Next message with the devices due for a report (out -> MESH_MESSAGE_MAX bytes),
+  // returns its length or 0 once nothing is due. Call until it returns 0
+  size_t build(const PresenceTable& table, uint8_t node, uint32_t nowMs, uint8_t* out);
+
+  uint32_t reports() const { return m_reports; }   // Device reports sent
+
+private:
+  struct Reported {
+    uint32_t hash;      // Device of the entry when it was reported, 0 -> never
+    uint32_t timeMs;
+    int8_t rssi;
+  };
+
+  Reported m_reported[PresenceTable::CAPACITY];
+  uint32_t m_refreshMs;
+  uint8_t m_rssiStep;
+  uint8_t m_sequence;
+  uint32_t m_reports;
+};
@@ -0,0 +1,88 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Merged presence of all scanner nodes (head node only)
+  * One entry per device address hash, however many nodes hear it. The entry keeps the strongest RSSI of
+  * the nodes that recently reported the device (the closest node), so a device between two nodes is
+  * counted once. Fixed capacity chained hash over a preallocated pool, counts are kept up to date on
+  * every report like PresenceTable, expiry walks the least recently reported end only.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mesh_protocol.h"
+
+struct MeshEntry {
+  uint32_t hash;
+  uint32_t seenMs;      // Latest last-seen time of any node (head clock)
+  uint32_t bestMs;      // Time the node with the strongest RSSI last reported it
+  int8_t rssi;          // Strongest recent RSSI
+  uint8_t node;         // Node that reported rssi
+  uint8_t ranges;       // Radius bits rssi is inside of (see MeshTable::RANGE_*)
+  uint16_t next;        // Hash chain
+  uint16_t lruPrev;     // Least recently reported order
+  uint16_t lruNext;
+};
+
+class MeshTable {
+public:
+  static const size_t CAPACITY = 512;   // Devices of the whole room, the least recently reported one is dropped when full
+  static const uint8_t RANGE_NORMAL = 0x01;
+  static const uint8_t RANGE_FOOTSTEP = 0x02;
+
+  MeshTable();
+
+  void clear();
+
+  // ttlMs -> forget a device no node heard for this long
+  void configure(uint32_t ttlMs);
+  // RSSI radius thresholds (dBm), recounts all entries if they change
+  void setThresholds(int threshold, int thresholdFootstep);
+
+  // Merge a message of a node (see mesh_protocol.h), false if it is not a valid message
+  bool apply(const uint8_t* message, size_t length, uint32_t nowMs);
+  void report(uint8_t node, const MeshReport& report, uint32_t nowMs);
+
+  // Remove every device not heard within the TTL
+  void expire(uint32_t nowMs);
+
+  size_t size() const { return m_size; }
+  int count() const { return m_count; }                  // Devices inside of the normal radius of any node
+  int countFootstep() const { return m_countFootstep; }  // Devices inside of the footstep radius of any node
+  uint32_t evictions() const { return m_evictions; }     // Devices dropped because the table was full
+  uint32_t messages() const { return m_messages; }       // Valid messages merged
+
+private:
+  static const uint16_t NONE = 0xFFFF;
+  static const size_t BUCKETS = 1024;   // Power of two, twice the capacity
+
+  static size_t bucketOf(uint32_t hash) { return (hash >> 8) & (BUCKETS - 1); }
+  uint8_t rangesOf(int8_t rssi) const;
+  void setRanges(MeshEntry& entry, uint8_t ranges);
+  void lruUnlink(uint16_t index);
+  void lruAppend(uint16_t index);
+  void removeEntry(uint16_t index);
+
+  MeshEntry m_entries[CAPACITY];
+  uint16_t m_buckets[BUCKETS];
+  uint16_t m_freeHead;
+  uint16_t m_lruHead;   // Least recently reported
+  uint16_t m_lruTail;
+  size_t m_size;
+
+  uint32_t m_ttlMs;
+  int m_threshold;
+  int m_thresholdFootstep;
+
+  int m_count;
+  int m_countFootstep;
+  uint32_t m_evictions;
+  uint32_t m_messages;
+};
@@ -0,0 +1,48 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Occupancy trend
+  * Arrival and departure rate and the mean dwell time of the audience, from the running totals of the
+  * presence table (see PresenceTable::arrivals()). Once a second the new arrivals and departures are
+  * folded into exponential moving averages, O(1) per update whatever the crowd size, so the Teensy can
+  * tell "people arriving" from "people leaving" before the count crosses a mode threshold.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+class OccupancyTrend {
+public:
+  OccupancyTrend();
+
+  // windowS -> time constant of the rate averages (s), at least 1
+  void configure(uint16_t windowS);
+
+  // Once per aggregation pass with the running totals of the presence table
+  void update(uint32_t nowMs, uint32_t arrivals, uint32_t departures, uint64_t dwellTotalMs);
+
+  uint16_t arrivalRate() const;     // Arrivals per minute x 10
+  uint16_t departureRate() const;   // Departures per minute x 10
+  uint16_t meanDwell() const;       // Mean time (s) from first to last seen of the departed audience
+
+private:
+  static const uint32_t SAMPLE_MS = 1000;
+  static const uint32_t DWELL_WEIGHT = 8;   // Departures in the dwell average (exponential)
+
+  static uint16_t saturate(int32_t value) { return (value < 0) ? 0 : (value > 0xFFFF ? 0xFFFF : (uint16_t)value); }
+
+  uint16_t m_window;
+  uint32_t m_sampleMs;
+  bool m_started;
+  uint32_t m_arrivals;      // Totals at the last sample
+  uint32_t m_departures;
+  uint64_t m_dwellTotalMs;
+  int32_t m_arrivalRateQ8;  // Per minute x 10, Q8 fixed point
+  int32_t m_departureRateQ8;
+  int32_t m_dwellQ8;        // Seconds, Q8 fixed point
+};
@@ -0,0 +1,34 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Power management
+  * While the audience is present (or a calibration runs) the CPU runs at full clock. Once the scan scheduler
+  * goes idle (empty room) it drops to the minimum clock the BLE controller allows:
+  * - Core built with CONFIG_PM_ENABLE => esp_pm locks, and in POWER_LIGHT_SLEEP (CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+  *   light sleep between the scan windows. An I2C start condition (SDA low) wakes it up again.
+  * - Stock Arduino core (every env in platformio.ini, esp_pm returns ESP_ERR_NOT_SUPPORTED) => the clock is set
+  *   directly with setCpuFrequencyMhz(), no light sleep, so POWER_LIGHT_SLEEP runs as POWER_SCALING.
+  * The minimum is 80 MHz, where the APB clock stays at 80 MHz: the I2C slave, the UART and the BLE controller
+  * keep their timing, only the code runs slower.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+enum PowerMode {
+  POWER_FULL = 0,          // Full clock all the time
+  POWER_SCALING = 1,       // Minimum clock while the room is empty
+  POWER_LIGHT_SLEEP = 2    // Minimum clock and light sleep between the scan windows while the room is empty
+};
+
+// wakePin -> GPIO that wakes the CPU from light sleep when pulled low (I2C SDA), -1 -> none
+// Returns the PowerMode that is in effect (lower than mode if the core does not support it)
+uint8_t powerBegin(uint8_t mode, int wakePin);
+
+// Active -> full clock and no light sleep (audience present), else the power mode applies
+void powerSetActive(bool active);
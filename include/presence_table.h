@@ -0,0 +1,132 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Sliding window presence estimator
+  * Fixed capacity last-seen table keyed by MAC address. Every entry keeps a smoothed, TX power corrected
+  * RSSI (see rssi_filter.h) and the time it was last heard, and ages out after a TTL. The radius counts are kept up to date on every
+  * update, so reading them is O(1) and a single missed advert no longer drops a device.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "allowlist.h"
+#include "device_record.h"
+#include "rssi_filter.h"
+
+struct PresenceEntry {
+  MacKey address;
+  uint32_t firstSeenMs;
+  uint32_t lastSeenMs;
+  uint32_t fingerprint;  // Advert payload fingerprint, 0 -> unknown
+  RssiFilterState rssi;  // Smoothed, corrected RSSI
+  int8_t txPower;       // Best TX power known for the device, TX_POWER_UNKNOWN -> uncorrected
+  uint8_t txSource;     // TxPowerSource of txPower
+  uint8_t addressType;
+  uint8_t ranges;       // Radius bits the smoothed RSSI is currently inside of (see PresenceTable::RANGE_*)
+                        // + RANGE_ARRIVED once it has been inside of the normal radius
+  uint16_t next;        // Hash chain
+  uint16_t fingerprintNext;  // Chain of the entries in the same fingerprint bucket
+  uint16_t lruPrev;     // Least recently seen order
+  uint16_t lruNext;
+};
+
+class PresenceTable {
+public:
+  static const size_t CAPACITY = 256;   // Maximum number of tracked devices, see evictionCandidate() when full
+  static const uint8_t RANGE_NORMAL = 0x01;
+  static const uint8_t RANGE_FOOTSTEP = 0x02;
+  static const uint8_t RANGE_ARRIVED = 0x80;
+
+  PresenceTable();
+
+  void clear();
+
+  // ttlMs -> forget a device not heard for this long, filter -> RSSI smoothing and TX power reference
+  void configure(uint32_t ttlMs, const RssiFilterConfig& filter);
+  // RSSI radius thresholds (dBm), recounts all entries if they change
+  void setThresholds(int threshold, int thresholdFootstep);
+
+  // Insert or refresh a device, returns the entry or nullptr only if the capacity is zero
+  // isNew is set when the device was not tracked before
+  const PresenceEntry* update(const DeviceRecord& record, bool* isNew);
+
+  // Remove every entry not heard within the TTL
+  void expire(uint32_t nowMs);
+
+  // Address rotation: after an advert of a new address, merge the entry of the device it rotated away from.
+  // That entry has the same address type, advert fingerprint and an RSSI within rssiTolerance dB, fell
+  // silent less than minGapMs before the new address appeared and has stayed silent for minGapMs since.
+  // The new entry keeps the first-seen time of the old one. Returns true if merged, retired receives
+  // the address of the removed entry
+  bool mergeRotation(MacKey address, uint32_t nowMs, uint32_t minGapMs, int rssiTolerance, MacKey* retired);
+
+  const PresenceEntry* find(MacKey address) const;
+
+  // All entries, least recently seen first: for (e = oldest(); e != nullptr; e = newer(e))
+  const PresenceEntry* oldest() const { return (m_lruHead != NONE) ? &m_entries[m_lruHead] : nullptr; }
+  const PresenceEntry* newer(const PresenceEntry* entry) const {
+    return (entry->lruNext != NONE) ? &m_entries[entry->lruNext] : nullptr;
+  }
+  size_t indexOf(const PresenceEntry* entry) const { return (size_t)(entry - m_entries); }  // 0 .. CAPACITY-1
+
+  size_t size() const { return m_size; }
+  int count() const { return m_count; }                  // Devices inside of the normal radius
+  int countFootstep() const { return m_countFootstep; }  // Devices inside of the footstep radius
+  uint32_t evictions() const { return m_evictions; }     // Devices dropped because the table was full
+  uint32_t takeovers() const { return m_takeovers; }     // Address rotations merged into an existing device
+
+  // Running totals for the occupancy trend: devices that entered the normal radius, devices that had been
+  // inside and are gone (aged out or evicted), summed time from first to last seen of those (ms)
+  uint32_t arrivals() const { return m_arrivals; }
+  uint32_t departures() const { return m_departures; }
+  uint64_t dwellTotalMs() const { return m_dwellTotalMs; }
+
+private:
+  static const uint16_t NONE = 0xFFFF;
+  static const size_t BUCKETS = 512;    // Power of two, twice the capacity
+  static const size_t EVICTION_PROBE = 8;  // Least recently seen entries looked at when the table is full
+  static const size_t ROTATION_PROBE = 32; // Entries with the same fingerprint looked at for an address rotation
+
+  static size_t bucketOf(MacKey address);
+  static size_t fingerprintBucketOf(uint32_t fingerprint) { return ((fingerprint * 2654435761u) >> 16) & (BUCKETS - 1); }
+  uint16_t evictionCandidate() const;
+  uint8_t rangesOf(int16_t rssiQ4) const;
+  void setRanges(PresenceEntry& entry, uint8_t ranges);
+  void lruUnlink(uint16_t index);
+  void lruAppend(uint16_t index);
+  void removeEntry(uint16_t index);
+  void departed(uint16_t index);
+  void unlinkBucket(uint16_t index);
+  void linkFingerprint(uint16_t index);
+  void unlinkFingerprint(uint16_t index);
+  void refresh(uint16_t index, const DeviceRecord& record);
+  void adoptTxPower(PresenceEntry& entry, const DeviceRecord& record);
+
+  PresenceEntry m_entries[CAPACITY];
+  uint16_t m_buckets[BUCKETS];
+  uint16_t m_fingerprintBuckets[BUCKETS];
+  uint16_t m_freeHead;
+  uint16_t m_lruHead;   // Least recently seen
+  uint16_t m_lruTail;   // Most recently seen
+  size_t m_size;
+
+  uint32_t m_ttlMs;
+  RssiFilterConfig m_filter;
+  int m_threshold;
+  int m_thresholdFootstep;
+
+  int m_count;
+  int m_countFootstep;
+  uint32_t m_evictions;
+  uint32_t m_takeovers;
+  uint32_t m_arrivals;
+  uint32_t m_departures;
+  uint64_t m_dwellTotalMs;
+};
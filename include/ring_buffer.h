@@ -0,0 +1,69 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Lock-free single producer / single consumer ring buffer
+  * The BLE callback pushes scan records, the consumer drains them without ever blocking the radio.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+template <typename T, size_t N>
+class RingBuffer {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "RingBuffer size must be a power of two");
+
+public:
+  RingBuffer() : m_head(0), m_tail(0), m_dropped(0) {}
+
+  // Producer side, drops the item (and counts it) when the buffer is full
+  bool push(const T& item) {
+    uint32_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= N) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    m_items[head & (N - 1)] = item;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Producer side, zero-copy variant => fill the returned slot in place, then commit() it
+  T* acquire() {
+    uint32_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= N) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &m_items[head & (N - 1)];
+  }
+  void commit() {
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Consumer side
+  bool pop(T& item) {
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = m_items[tail & (N - 1)];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t count() const { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire); }
+  uint32_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  T m_items[N];
+  std::atomic<uint32_t> m_head;
+  std::atomic<uint32_t> m_tail;
+  std::atomic<uint32_t> m_dropped;
+};
@@ -0,0 +1,45 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * RSSI smoothing and transmit power correction
+  * Every sample is first corrected to a reference transmitter: with the log-distance path loss model the
+  * same corrected RSSI means the same distance, whether it came from a loud phone or a weak earbud.
+  * A median of the last three samples removes single fading dips, then a scalar Kalman filter smooths
+  * the rest. Fixed-point integer math, one division per sample.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+static const int8_t TX_POWER_UNKNOWN = 127;
+static const int TX_CORRECTION_LIMIT = 20;   // dB, guards against broken TX power fields
+
+// Where the TX power of a device comes from, a better source replaces a worse one
+enum TxPowerSource {
+  TX_SOURCE_NONE = 0,
+  TX_SOURCE_CLASS,        // Default of the device class (appearance)
+  TX_SOURCE_ADVERTISED    // TX power level AD field
+};
+
+struct RssiFilterConfig {
+  uint8_t processNoise;       // dB^2 the true RSSI may drift per sample (movement)
+  uint8_t measurementNoise;   // dB^2 of a single sample (fading)
+  int8_t txPowerReference;    // TX power (dBm) the RSSI thresholds are meant for
+};
+
+struct RssiFilterState {
+  int16_t estimateQ4;     // Smoothed, corrected RSSI in 1/16 dBm
+  uint16_t varianceQ4;    // Estimate variance in 1/16 dB^2
+  int8_t recent[2];       // Last two corrected samples (median of three)
+};
+
+// RSSI as if the device transmitted with the reference power
+int8_t rssiCorrected(int8_t rssi, int8_t txPower, const RssiFilterConfig& config);
+
+void rssiFilterReset(RssiFilterState& state, int8_t sample, const RssiFilterConfig& config);
+int16_t rssiFilterUpdate(RssiFilterState& state, int8_t sample, const RssiFilterConfig& config);  // Returns estimateQ4
@@ -0,0 +1,56 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Occupancy driven scan duty-cycle scheduler
+  * Empty room for a while -> passive scan with a sparse window. Audience present -> active, dense scan.
+  * While present, the window is narrowed when the advert rate shows there are more samples than
+  * needed and widened again when it drops, so the radio duty follows the crowd.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "scanner.h"
+
+struct ScanSchedulerConfig {
+  ScanSettings present;         // Audience in the area (window is the widest one used)
+  ScanSettings idle;            // Empty room
+  uint32_t idleAfterMs;         // No presence for this long -> idle settings
+  uint16_t busyAdvertRate;      // Adverts/s above which the window is halved
+  uint16_t quietAdvertRate;     // Adverts/s below which the window is doubled again
+  uint8_t minWindowPercent;     // Narrowest window, percent of present.window
+};
+
+class ScanScheduler {
+public:
+  ScanScheduler();
+
+  void configure(const ScanSchedulerConfig& config, uint32_t nowMs);
+
+  // Once per aggregation pass with the adverts received since the last call (every scan callback, counted
+  // before any filtering, so the rate scales with the window), true if settings() changed
+  bool update(uint32_t nowMs, bool presence, uint32_t adverts);
+
+  const ScanSettings& settings() const { return m_settings; }
+  bool idle() const { return m_idle; }
+  uint16_t advertRate() const { return m_advertRate; }   // Adverts/s over the last second
+
+private:
+  static const uint32_t RATE_PERIOD_MS = 1000;
+
+  ScanSettings presentSettings() const;
+
+  ScanSchedulerConfig m_config;
+  ScanSettings m_settings;
+  bool m_idle;
+  uint8_t m_windowPercent;
+  uint32_t m_lastPresenceMs;
+  uint32_t m_rateStartMs;
+  uint32_t m_rateAdverts;
+  uint16_t m_advertRate;
+};
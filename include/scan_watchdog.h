@@ -0,0 +1,55 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Scan pipeline watchdog
+  * Runs in the scan task and watches the scan callback for progress. A scan that stops delivering adverts
+  * or does not come up again is recovered in place, cheapest step first:
+  *   restart the scan -> still stalled -> reinitialize the BLE stack -> still stalled -> restart with a longer timeout
+  * Any advert ends the recovery. A genuinely quiet room only costs an occasional restart, the timeout doubles on
+  * every round up to MAX_BACKOFF. A scan task that blocks inside the stack is left to the task watchdog (reboot).
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+enum WatchdogAction : uint8_t {
+  WATCHDOG_NONE,
+  WATCHDOG_RESTART_SCAN,    // Stop and start the scan again
+  WATCHDOG_REINIT_STACK,    // Bring the BLE stack down and up, then start the scan
+};
+
+class ScanWatchdog {
+public:
+  static const uint32_t START_TIMEOUT_MS = 2000;   // Scan not running for this long -> stalled
+  static const uint8_t MAX_BACKOFF = 8;            // Longest stall timeout, multiple of the configured one
+
+  ScanWatchdog();
+
+  // stallTimeoutMs -> no advert for this long while scanning is a stall
+  void configure(uint32_t stallTimeoutMs, uint32_t nowMs);
+
+  // Once per scan task pass with the number of scan callbacks so far and whether the stack reports a running scan
+  WatchdogAction update(uint32_t nowMs, uint32_t results, bool running);
+
+  uint32_t stallTimeout() const { return m_stallTimeoutMs; }
+  bool recovering() const { return m_level != 0; }
+
+  // True once after a recovery ended, durationMs -> from the stall to the first advert after it
+  bool recovered(uint32_t* durationMs);
+
+private:
+  uint32_t m_stallTimeoutMs;
+  uint32_t m_results;
+  uint32_t m_progressMs;    // Last advert or recovery step
+  uint32_t m_runningMs;     // Last pass the scan was running
+  uint32_t m_stalledMs;
+  uint32_t m_recoveryMs;
+  uint8_t m_level;          // 0 -> healthy, 1 -> scan restarted, 2 -> stack reinitialized
+  uint8_t m_backoff;
+  bool m_recovered;
+};
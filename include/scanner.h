@@ -0,0 +1,56 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * BLE scanner front end
+  * Adverts are handed to the callbacks straight from the GAP scan result as a ScanResult view,
+  * without creating BLEAdvertisedDevice objects or any heap allocation per advert.
+  *
+  * Backend is chosen at build time: -DSCANNER_BACKEND_NIMBLE -> NimBLE-Arduino (scanner_nimble.cpp),
+  * otherwise the Bluedroid stack of the Arduino core (scanner_bluedroid.cpp).
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// One received advert (or scan response). Only valid during the onResult() call
+struct ScanResult {
+  const uint8_t* address;   // 6 address bytes
+  uint8_t addressType;      // BLE_ADDR_TYPE_xxx
+  int8_t rssi;              // dBm
+  const uint8_t* payload;   // Raw advertising data (AD structures)
+  uint8_t payloadLength;
+  bool scanResponse;        // Payload is a scan response, not the advert itself
+};
+
+struct ScanSettings {
+  bool active;              // Active scan uses more power, but get results faster
+  uint16_t interval;        // Scan interval (ms)
+  uint16_t window;          // Scan window (ms), less or equal to interval
+  bool filterDuplicates;    // Controller drops repeated adverts of an address until the scan restarts
+  // Scan task supervision, not passed to the stack
+  uint16_t duplicateReset;  // Restart period of a scan with filterDuplicates (ms)
+  uint16_t stallTimeout;    // No advert for this long (ms) -> scan watchdog recovery, 0 -> off
+  uint32_t stallHold;       // Audience state held this long (ms) when a recovery starts
+};
+
+class ScanCallbacks {
+public:
+  virtual ~ScanCallbacks() {}
+  // Called from the BT host task for every advert => keep it short, nothing slow may run here
+  virtual void onResult(const ScanResult& result) = 0;
+};
+
+bool scannerBegin(ScanCallbacks* callbacks);        // Bring up the BLE stack
+bool scannerStart(const ScanSettings& settings);    // Start a continuous scan
+void scannerStop();
+bool scannerRunning();                              // False once the scan ended or failed to start
+
+// Recovery of a stalled scan (scan_watchdog.h), called from the scan task only
+bool scannerRestart(const ScanSettings& settings);  // Stop without waiting for the stack to confirm, then start
+bool scannerReset();                                // Bring the BLE stack down and up again, the scan is stopped
@@ -0,0 +1,98 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Runtime configuration of the scanner
+  * Every tunable lives in one compact struct that is stored as a single versioned NVS blob, read once at
+  * boot and afterwards only replaced as a whole. Fields can be read and changed by name (serial console)
+  * or by index (I2C); fields marked as boot fields are stored but only take effect after a restart.
+  * The console and I2C edit a stored copy, the running config takes it over with its own boot fields kept.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct ScannerConfig {
+  // ***** Detection radius and audience modes ***** //
+  int8_t rssiThreshold;           // Normal Bluetooth detection radius (dBm)
+  int8_t rssiThresholdFootstep;   // Footstep Bluetooth detection radius (dBm)
+  uint16_t audienceSmallEnter;    // Devices in range to switch to the small audience mode ('f')
+  uint16_t audienceSmallExit;     // Devices in range below which the small audience mode is left
+  uint16_t audienceLargeEnter;    // Devices in range to switch to the large audience mode ('r')
+  uint16_t audienceLargeExit;     // Devices in range below which the large audience mode is left
+  uint16_t modeMinDwell;          // Minimum time (ms) in an audience mode before it changes again
+
+  // ***** Scan duty cycle ***** //
+  bool activeScan;                // Active scan uses more power, but get results faster (while audience is present)
+  uint16_t scanInterval;          // Scanning interval time (ms)
+  uint16_t scanWindow;            // Scanning window (ms), less or equal to the scan interval
+  uint16_t idleScanInterval;      // Scanning interval time while the room is empty (passive scan)
+  uint16_t idleScanWindow;        // Scanning window while the room is empty
+  uint32_t idleAfter;             // No audience for this long (ms) -> idle scan
+  uint16_t busyAdvertRate;        // Adverts/s above which the scan window is narrowed
+  uint16_t quietAdvertRate;       // Adverts/s below which the scan window is widened again
+  uint8_t minWindowPercent;       // Narrowest scan window, percent of scanWindow
+
+  // ***** Advert load ***** //
+  bool filterDuplicates;          // Controller duplicate filter, the scan is restarted every duplicateReset
+  uint16_t duplicateReset;        // Controller duplicate cache reset period (ms)
+  uint16_t advertRateLimit;       // At most one advert per address every n ms is processed, 0 -> off
+  uint16_t scanStallTimeout;      // No advert for this long (ms) -> the scan watchdog recovers the scan, 0 -> off
+
+  // ***** Presence estimator ***** //
+  uint32_t presenceTtl;           // A device not heard for this long (ms) has left the area
+  uint8_t rssiMeasurementNoise;   // RSSI noise of a single advert (dB^2), more -> smoother but slower
+  uint8_t rssiProcessNoise;       // RSSI drift between two adverts of a device (dB^2), more -> follows faster
+  int8_t txPowerReference;        // TX power (dBm) of the device the RSSI thresholds are meant for
+  uint16_t rotationMinGap;        // Old random address silent within this (ms) before the new one and this long since -> rotation
+  uint8_t rotationRssiTolerance;  // RSSI difference (dB) still accepted as the same device after a rotation
+  uint32_t retiredMemory;         // Retired addresses are ignored for one to two of these periods (ms)
+  uint16_t trendWindow;           // Time constant (s) of the arrival / departure rates sent to the Teensy
+
+  // ***** Outputs ***** //
+  uint8_t reportInterval;         // Report (serial + LEDs) interval time (s)
+  int8_t ledGreen;                // Green LED Control Pin (Devices are within rssiThreshold range)
+  int8_t ledRed;                  // Red LED Control Pin (Devices are within rssiThresholdFootstep range)
+  uint8_t ledBlinkTime;           // LED on/off time of a single blink (ms)
+  uint8_t i2cAddress;             // I2C slave address the Teensy reads from
+  int8_t dataReadyPin;            // Data-ready output to the Teensy (active high), -1 -> not connected
+  uint8_t dataReadyCountStep;     // Count change since the last notification that is worth a notification
+
+  // ***** Calibration (learns the stationary devices of an empty venue) ***** //
+  bool calibrateOnBoot;           // Calibrate after the next boot, cleared once the allowlist is learned
+  uint8_t calibrationMinutes;     // Calibration scan time (minutes)
+  uint8_t calibrationPresence;    // Percent of the calibration windows a stationary device is heard in
+  uint8_t calibrationRssiSpread;  // Maximum RSSI standard deviation (dB) of a stationary device
+
+  // ***** Trace recording (see trace_recorder.h) ***** //
+  uint16_t traceSizeKb;           // Flash used by a trace (KB), the oldest half is overwritten when full
+  bool tracePayload;              // Record the advert payloads (needed to replay fingerprints and TX power)
+
+  // ***** Multi-scanner room (see mesh_protocol.h) ***** //
+  uint8_t meshRole;               // MeshRole: 0 single scanner, 1 node (reports to the head), 2 head (serves the Teensy)
+  uint8_t meshNodeId;             // Unique id of this scanner in the room, 0 -> low byte of the eFuse MAC
+  uint8_t meshChannel;            // WiFi channel of the ESP-NOW link, the same on all nodes
+  uint16_t meshInterval;          // Report batch period (ms)
+  uint16_t meshRefresh;           // An unchanged device is reported again this often (ms), below presenceTtl
+  uint8_t meshRssiStep;           // RSSI change (dB) of a device that is reported before its refresh
+
+  // ***** Power (see power_manager.h) ***** //
+  uint8_t powerMode;              // PowerMode while the room is empty: 0 full clock, 1 frequency scaling, 2 + light sleep
+};
+
+void configDefaults(ScannerConfig& config);
+bool configValid(const ScannerConfig& config);   // Cross-field checks (window <= interval, exit <= enter, ...)
+
+// ***** Named field access ***** //
+size_t configFieldCount();
+const char* configFieldName(size_t field);
+bool configFieldFind(const char* name, size_t* field);
+bool configFieldIsBoot(size_t field);            // Only takes effect after a restart
+void configKeepBoot(ScannerConfig& config, const ScannerConfig& running);  // Boot fields of running -> config
+int32_t configFieldGet(const ScannerConfig& config, size_t field);
+bool configFieldSet(ScannerConfig& config, size_t field, int32_t value);  // False -> out of range, unchanged
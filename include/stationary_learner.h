@@ -0,0 +1,60 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Stationary device learner (calibration of the known device allowlist)
+  * While the venue is empty, every address heard is tracked for a fixed time split into windows.
+  * Devices heard in (almost) every window with a steady RSSI are routers, speakers, beacons, ...
+  * and become the allowlist, so they never reach the audience count.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "allowlist.h"
+#include "device_record.h"
+
+class StationaryLearner {
+public:
+  static const size_t CAPACITY = 128;  // Candidates tracked during one calibration
+  static const uint8_t WINDOWS = 16;   // The calibration time is split into this many windows
+
+  StationaryLearner();
+
+  void begin(uint32_t nowMs, uint32_t durationMs);
+  void stop() { m_running = false; }
+  bool running() const { return m_running; }
+  bool finished(uint32_t nowMs) const { return m_running && nowMs - m_startMs >= m_durationMs; }
+
+  void add(const DeviceRecord& record);
+
+  // Replace the list with every device heard in at least minPercent of the windows whose RSSI
+  // standard deviation is at most maxSpreadDb, returns the number of devices (Allowlist::CAPACITY at most)
+  size_t result(Allowlist& list, uint8_t minPercent, uint8_t maxSpreadDb) const;
+
+  size_t candidates() const { return m_count; }
+  uint32_t overflow() const { return m_overflow; }   // Addresses not tracked because the table was full
+
+private:
+  static const size_t SLOTS = 256;     // Power of two, twice the capacity
+
+  struct Candidate {
+    MacKey address;
+    uint16_t windows;     // Bit per window the device was heard in
+    uint16_t samples;
+    int32_t rssiSum;
+    uint32_t rssiSquareSum;
+  };
+
+  Candidate m_slots[SLOTS];
+  size_t m_count;
+  uint32_t m_overflow;
+  uint32_t m_startMs;
+  uint32_t m_durationMs;
+  bool m_running;
+};
@@ -0,0 +1,46 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Binary I2C status frame sent to the Teensy
+  *
+  * Fixed size, all multi-byte fields little endian:
+  *   [0]      mode ('s' stop, 'f' footstep, 'r' random vibration) => first, so a 1-byte read still works
+  *   [1]      frame version (STATUS_FRAME_VERSION)
+  *   [2..3]   RSSI_TH_COUNT
+  *   [4..5]   RSSI_TH_COUNT_FOOTSTEP
+  *   [6..9]   sequence number, incremented every time mode or counts change
+  *   [10..11] age of the data in ms (saturates at 65535)
+  *   [12..13] arrivals per minute x 10 (see occupancy_trend.h)
+  *   [14..15] departures per minute x 10
+  *   [16..17] mean dwell time of the departed audience (s)
+  *   [18]     CRC-8 (poly 0x07, init 0x00) over bytes 0..17
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define STATUS_FRAME_VERSION 2
+#define STATUS_FRAME_SIZE 19
+
+// Audience state published by the aggregation task
+struct StatusSnapshot {
+  char mode;
+  uint16_t count;
+  uint16_t countFootstep;
+  uint32_t sequence;     // Only mode and counts change it, not the trend
+  uint16_t arrivalRate;
+  uint16_t departureRate;
+  uint16_t meanDwell;
+  uint32_t updatedMs;   // millis() of the aggregation pass that produced this state
+};
+
+uint8_t crc8(const uint8_t* data, size_t length);
+
+// Encode the frame for a request at nowMs, returns STATUS_FRAME_SIZE
+size_t encodeStatusFrame(const StatusSnapshot& status, uint32_t nowMs, uint8_t* frame);
@@ -0,0 +1,129 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Hot path telemetry
+  * Fixed counters for the latency of the scan callback, the I2C request handler, the aggregation pass
+  * and the LED pattern start, plus scan sessions and their recovery, advert rate, heap and task stack headroom.
+  * Nothing is printed while running, the report is produced on demand ("stats" on the serial console).
+  * Every statistic has a single writer (the context it measures), the report only reads. A reset is a request
+  * that each writer carries out on its own statistics the next time it runs.
+  * CPU cycles are converted to ns when sampled, at the clock the CPU runs at then (it changes with power management).
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <rom/ets_sys.h>
+
+#include <atomic>
+
+#ifndef SCANNER_TELEMETRY
+#define SCANNER_TELEMETRY 1   // 0 -> the measurements compile to nothing
+#endif
+#ifndef SCANNER_TELEMETRY_REPORT
+#define SCANNER_TELEMETRY_REPORT 0   // Print the report every n seconds (env:bench), 0 -> only on "stats"
+#endif
+
+struct TimingStat {
+  uint32_t count;
+  uint32_t max;
+  uint64_t total;
+};
+
+struct Telemetry {
+  TimingStat onResult;          // ns per scan callback
+  TimingStat requestEvent;      // ns per I2C request
+  TimingStat aggregation;       // us per aggregation pass (queue drain, estimator, scheduler)
+  TimingStat ledNotification;   // us to start an LED pattern
+  TimingStat scanSession;       // ms a scan ran before it was restarted or ended
+  TimingStat detection;         // ms from the first advert in range in an empty room to the published audience state
+  TimingStat scanRecovery;      // ms from a scan stall to the first advert after it (scan_watchdog.h)
+  uint16_t scanRestarts;        // Watchdog recovery steps
+  uint16_t stackReinits;
+  uint16_t advertRate;          // Adverts/s received by the scan callback (scan scheduler input)
+  uint32_t advertsFiltered;     // Adverts of device classes that are not counted (advert_filter.h)
+  uint16_t scanInterval;        // Scan settings in use (ms)
+  uint16_t scanWindow;
+  TaskHandle_t scanTask;
+  TaskHandle_t aggregationTask;
+};
+
+// Writers of the statistics, each one resets its own (see telemetryResetPending)
+enum TelemetryOwner : uint8_t {
+  TELEMETRY_SCAN_CALLBACK = 0x01,   // onResult, advertsFiltered
+  TELEMETRY_I2C = 0x02,             // requestEvent
+  TELEMETRY_SCAN_TASK = 0x04,       // scanSession, scanRecovery, scanRestarts, stackReinits
+  TELEMETRY_AGGREGATION = 0x08,     // aggregation, ledNotification, detection
+  TELEMETRY_OWNERS = 0x0F,
+};
+
+extern Telemetry telemetry;
+extern std::atomic<uint8_t> telemetryResetRequest;   // TelemetryOwner bits still to reset
+
+// Elapsed CPU cycles -> ns at the current clock, 32-bit only (no 64-bit division in the hot path)
+static inline uint32_t cyclesToNs(uint32_t cycles) {
+  uint32_t mhz = ets_get_cpu_frequency();
+  return cycles / mhz * 1000 + cycles % mhz * 1000 / mhz;
+}
+
+// True once for the owner after a reset was requested, one relaxed load otherwise
+static inline bool telemetryResetPending(uint8_t owner) {
+  if ((telemetryResetRequest.load(std::memory_order_relaxed) & owner) == 0) {
+    return false;
+  }
+  telemetryResetRequest.fetch_and((uint8_t)~owner, std::memory_order_acquire);
+  return true;
+}
+
+static inline void timingAdd(TimingStat& stat, uint32_t value) {
+  stat.count++;
+  stat.total += value;
+  if (value > stat.max) {
+    stat.max = value;
+  }
+}
+
+#if SCANNER_TELEMETRY
+#define TELEMETRY_CYCLES_START(name) uint32_t name = ESP.getCycleCount()
+#define TELEMETRY_CYCLES_STOP(stat, name) timingAdd(telemetry.stat, cyclesToNs(ESP.getCycleCount() - name))
+#define TELEMETRY_US_START(name) int64_t name = esp_timer_get_time()
+#define TELEMETRY_US_STOP(stat, name) timingAdd(telemetry.stat, (uint32_t)(esp_timer_get_time() - name))
+#define TELEMETRY_ADD(stat, value) timingAdd(telemetry.stat, value)
+#define TELEMETRY_SET(field, value) (telemetry.field = (value))
+#define TELEMETRY_COUNT(field) (telemetry.field++)
+#define TELEMETRY_RESET_POINT(owner) do { if (telemetryResetPending(owner)) telemetryReset(owner); } while (0)
+#else
+#define TELEMETRY_CYCLES_START(name) do {} while (0)
+#define TELEMETRY_CYCLES_STOP(stat, name) do {} while (0)
+#define TELEMETRY_US_START(name) do {} while (0)
+#define TELEMETRY_US_STOP(stat, name) do {} while (0)
+#define TELEMETRY_ADD(stat, value) ((void)(value))
+#define TELEMETRY_SET(field, value) ((void)(value))
+#define TELEMETRY_COUNT(field) do {} while (0)
+#define TELEMETRY_RESET_POINT(owner) do {} while (0)
+#endif
+
+// Telemetry frame of the I2C register map (i2c_registers.h), all values little endian, saturating:
+//   [0] TELEMETRY_FRAME_VERSION  [1..2] onResult avg ns  [3..4] onResult max ns  [5..6] requestEvent avg ns
+//   [7..8] aggregation avg us  [9..10] aggregation max us  [11..12] adverts/s  [13..16] free heap
+//   [17..20] largest free block  [21..22] detection max ms  [23] CRC-8 (as the status frame)
+#define TELEMETRY_FRAME_VERSION 1
+#define TELEMETRY_FRAME_SIZE 24
+
+struct TelemetryFrame {
+  uint8_t data[TELEMETRY_FRAME_SIZE];
+};
+
+// Report with the heap and stack figures sampled now
+void telemetryPrint(Print& out);
+// Frame with the heap sampled now (task context, not from the I2C callback)
+void telemetryEncode(TelemetryFrame& frame);
+// Any context => every owner resets its statistics at its next TELEMETRY_RESET_POINT
+void telemetryRequestReset();
+// Owner context only => clears the statistics written by owner (TelemetryOwner bits)
+void telemetryReset(uint8_t owner);
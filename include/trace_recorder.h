@@ -0,0 +1,38 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Advert trace recorder
+  * Appends every scan result to a trace on LittleFS (format: advert_trace.h), for replays on the host.
+  * The scan callback only encodes into one of two RAM buffers, a low priority writer task flushes the
+  * other one, so flash writes never stall the BLE stack (a record is dropped if the writer fell behind).
+  * The trace is a ring of two files of half the size each, the older one is overwritten when the
+  * current one is full. Without payloads every record is TRACE_RECORD_HEADER_SIZE bytes.
+  * Download: "trace dump" prints both files as hex between "trace begin" / "trace end" lines, on the host
+  *   sed -n '/^trace begin/,/^trace end/{//!p}' monitor.log | xxd -r -p > venue.blet
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "scanner.h"
+
+// Mount LittleFS (formatted if it cannot be mounted) and start the writer task on core
+bool traceRecorderBegin(int core);
+
+// Start a new trace of at most maxBytes (both files), payload -> keep the advert payloads
+void traceRecorderStart(uint32_t maxBytes, bool payload);
+void traceRecorderStop();          // Flushes the buffered records and closes the trace
+void traceRecorderDump();          // Print the trace as hex (only while not recording)
+bool traceRecorderRunning();
+
+// Scan callback context => copies the result into the RAM buffer, never blocks
+void traceRecorderAdd(const ScanResult& result, uint32_t nowMs);
+
+uint32_t traceRecorderRecords();   // Records written to flash since the start
+uint32_t traceRecorderDropped();   // Records lost because both buffers were full
@@ -0,0 +1,49 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Wait-free triple buffer for publishing a snapshot from one writer to one reader
+  * The writer never touches the slot being read, so the reader (e.g. the I2C request callback)
+  * always gets a complete snapshot without locks, retries or waiting on the writer.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+template <typename T>
+class TripleBuffer {
+public:
+  TripleBuffer() : m_back(0), m_middle(1), m_front(2) {}
+
+  // Writer side => fill the back slot and publish it
+  T& back() { return m_slots[m_back]; }
+  void publish() {
+    m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+  }
+  void write(const T& value) {
+    back() = value;
+    publish();
+  }
+
+  // Reader side => latest published snapshot, stays valid until the next call
+  const T& read() {
+    if (m_middle.load(std::memory_order_relaxed) & FRESH) {
+      m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+    return m_slots[m_front];
+  }
+
+private:
+  static const uint8_t INDEX_MASK = 0x03;
+  static const uint8_t FRESH = 0x04;   // Middle slot holds a snapshot the reader has not taken yet
+
+  T m_slots[3];
+  uint8_t m_back;                      // Owned by the writer
+  std::atomic<uint8_t> m_middle;       // Exchanged between both sides
+  uint8_t m_front;                     // Owned by the reader
+};
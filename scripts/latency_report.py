@@ -0,0 +1,109 @@
+# Hidden dependency project
+# Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+#
+# * Latency report of an env:bench run (host script, the counterpart of size_report.py)
+# * Reads a capture of the serial port with the periodic telemetry reports (SCANNER_TELEMETRY_REPORT) and
+# * prints one line per statistic: calls, overall average and maximum of the run plus the best and worst
+# * average of a single report period, then the lowest heap and stack headroom seen.
+# *   python scripts/latency_report.py bench.log > latency_report.txt
+# * The counters add up over the run, a period is the difference of two reports ("stats reset" starts over).
+#
+# This work is licensed under the Creative Commons Attribution 4.0 International License.
+# To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+
+import re
+import sys
+
+# Names as printed by telemetryPrint(), so a monitor prefix (time stamp, port) in front of a line does not matter
+TIMINGS = ("onResult", "requestEvent", "aggregation", "ledNotification", "scan session", "detection",
+           "scan recovery")
+
+TIMING = re.compile(r"(%s)\s+(\d+) calls\s+avg\s+(\d+) (\w+)\s+max\s+(\d+) \w+\s*$" % "|".join(TIMINGS))
+HEAP = re.compile(r"heap\s+(\d+) bytes free\s+(\d+) bytes largest block\s+(\d+) bytes lowest free\s*$")
+STACK = re.compile(r"(\S+(?: task)?)\s+(\d+) bytes stack headroom\s*$")
+
+
+class Timing:
+    def __init__(self, unit):
+        self.unit = unit
+        self.reports = 0
+        self.calls = 0         # Last report
+        self.total = 0
+        self.max = 0
+        self.periods = []      # Average of each report period with calls
+
+    def add(self, calls, avg, maximum):
+        total = calls * avg    # The report truncates the average, so the period averages are close, not exact
+        if calls < self.calls:
+            self.calls = 0     # Reset on the device
+            self.total = 0
+        if calls > self.calls:
+            self.periods.append((total - self.total) // (calls - self.calls))
+        self.reports += 1
+        self.calls = calls
+        self.total = total
+        self.max = max(self.max, maximum)
+
+
+def parse(lines):
+    timings = {}
+    heap = None
+    stacks = {}
+    for line in lines:
+        line = line.rstrip()
+        match = TIMING.search(line)
+        if match:
+            name, calls, avg, unit, maximum = match.groups()
+            timings.setdefault(name, Timing(unit)).add(int(calls), int(avg), int(maximum))
+            continue
+        match = HEAP.search(line)
+        if match:
+            free, block, lowest = (int(value) for value in match.groups())
+            heap = (free, block, lowest) if heap is None else (min(heap[0], free), min(heap[1], block),
+                                                               min(heap[2], lowest))
+            continue
+        match = STACK.search(line)
+        if match:
+            name, headroom = match.group(1), int(match.group(2))
+            stacks[name] = min(stacks.get(name, headroom), headroom)
+    return timings, heap, stacks
+
+
+def report(timings, heap, stacks):
+    lines = []
+    reports = max([timing.reports for timing in timings.values()] or [0])
+    lines.append("reports   %d" % reports)
+    for name in TIMINGS:
+        timing = timings.get(name)
+        if timing is None or timing.calls == 0:
+            continue
+        periods = timing.periods or [0]
+        lines.append("%-16s %10d calls  avg %7d %s  max %7d %s  period avg %d..%d %s" % (
+            name, timing.calls, timing.total // timing.calls, timing.unit, timing.max, timing.unit,
+            min(periods), max(periods), timing.unit))
+    if heap is not None:
+        lines.append("%-16s %10d bytes free  %d bytes largest block  %d bytes lowest free (minimum of the run)" %
+                     (("heap",) + heap))
+    for name in sorted(stacks):
+        lines.append("%-16s %10d bytes stack headroom (minimum of the run)" % (name, stacks[name]))
+    return lines
+
+
+def main(argv):
+    if len(argv) > 2:
+        sys.stderr.write("usage: latency_report.py [bench.log]\n")
+        return 2
+    if len(argv) == 2:
+        with open(argv[1], errors="replace") as capture:
+            parsed = parse(capture)
+    else:
+        parsed = parse(sys.stdin)
+    if not parsed[0]:
+        sys.stderr.write("no telemetry report in the capture (env:bench prints one every SCANNER_TELEMETRY_REPORT s)\n")
+        return 1
+    print("\n".join(report(*parsed)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
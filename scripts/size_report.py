@@ -0,0 +1,96 @@
+# Hidden dependency project
+# Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+#
+# * Size report of a firmware build (extra_scripts of the esp32 environments)
+# * After linking, the ELF sections are summed into IRAM, DRAM and flash and written together with the build
+# * flags and the git revision to .pio/build/<env>/size_report.txt, so two profiles can be compared and the
+# * numbers reproduced from the same revision.
+# * The flags are the ones the compiler gets (after extends, build_unflags and the platform defaults), and a
+# * profile that ends up with two optimization levels or two values of one define fails before compiling.
+#
+# This work is licensed under the Creative Commons Attribution 4.0 International License.
+# To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+
+import subprocess
+import sys
+
+Import("env")
+
+IRAM = (".iram0.vectors", ".iram0.text")
+DRAM = (".dram0.data", ".dram0.bss", ".noinit")
+FLASH = (".flash.appdesc", ".flash.rodata", ".flash.text", ".dram0.data", ".iram0.vectors", ".iram0.text")
+
+
+def sections(elf):
+    output = subprocess.check_output([env.subst("$SIZETOOL"), "-A", elf], universal_newlines=True)
+    sizes = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) == 3 and fields[0].startswith(".") and fields[1].isdigit():
+            sizes[fields[0]] = int(fields[1])
+    return sizes
+
+
+def optimization():
+    return [flag for scope in ("CCFLAGS", "CFLAGS", "CXXFLAGS") for flag in env.get(scope, [])
+            if isinstance(flag, str) and flag.startswith("-O")]
+
+
+# Defines of the scanner and the NimBLE host config as name -> list of values
+def defines():
+    found = {}
+    for define in env.get("CPPDEFINES", []):
+        name, value = (define[0], str(define[1])) if isinstance(define, (list, tuple)) else (str(define), None)
+        if name.startswith(("SCANNER_", "CONFIG_BT_NIMBLE_")):
+            found.setdefault(name, []).append(value)
+    return found
+
+
+def effective_flags():
+    flags = optimization()
+    for name, values in sorted(defines().items()):
+        flags += ["-D%s" % name if value is None else "-D%s=%s" % (name, value) for value in values]
+    return flags
+
+
+def check_flags():
+    errors = []
+    if len(set(optimization())) > 1:
+        errors.append("optimization levels %s (build_unflags missing?)" % " ".join(optimization()))
+    for name, values in sorted(defines().items()):
+        if len(set(values)) > 1:
+            errors.append("%s defined as %s" % (name, ", ".join(str(value) for value in values)))
+    if errors:
+        sys.stderr.write("Error: env:%s build flags conflict: %s\n" % (env["PIOENV"], "; ".join(errors)))
+        env.Exit(1)
+
+
+def revision():
+    try:
+        return subprocess.check_output(["git", "describe", "--always", "--dirty"], cwd=env.subst("$PROJECT_DIR"),
+                                       universal_newlines=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def size_report(source, target, env):
+    sizes = sections(target[0].get_abspath())
+
+    def total(names):
+        return sum(sizes.get(name, 0) for name in names)
+
+    lines = [
+        "env       %s" % env["PIOENV"],
+        "revision  %s" % revision(),
+        "flags     %s" % " ".join(effective_flags()),
+        "iram      %7d bytes" % total(IRAM),
+        "dram      %7d bytes (data + bss)" % total(DRAM),
+        "flash     %7d bytes" % total(FLASH),
+    ]
+    with open(env.subst("$BUILD_DIR/size_report.txt"), "w") as report:
+        report.write("\n".join(lines) + "\n")
+    print("\n".join(lines))
+
+
+check_flags()
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", size_report)
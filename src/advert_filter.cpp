@@ -0,0 +1,266 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Advert payload filter (compiled rule table)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "advert_filter.h"
+#include "hot_path.h"
+
+// AD types (Bluetooth Assigned Numbers)
+static const uint8_t AD_UUID16_INCOMPLETE = 0x02;
+static const uint8_t AD_UUID16_COMPLETE = 0x03;
+static const uint8_t AD_UUID32_INCOMPLETE = 0x04;
+static const uint8_t AD_UUID32_COMPLETE = 0x05;
+static const uint8_t AD_UUID128_INCOMPLETE = 0x06;
+static const uint8_t AD_UUID128_COMPLETE = 0x07;
+static const uint8_t AD_SERVICE_DATA16 = 0x16;
+static const uint8_t AD_APPEARANCE = 0x19;
+static const uint8_t AD_SERVICE_DATA32 = 0x20;
+static const uint8_t AD_SERVICE_DATA128 = 0x21;
+static const uint8_t AD_MANUFACTURER = 0xFF;
+
+// Bluetooth base UUID 00000000-0000-1000-8000-00805F9B34FB without the 32-bit value, little endian
+static const uint8_t BASE_UUID[12] = { 0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00 };
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Number without sign or trailing characters, base 0 -> decimal or 0x hex
+static bool parseNumber(const char* text, int base, uint32_t max, uint32_t* value) {
+  char* end;
+  if (text[0] == '\0' || text[0] == '-') {
+    return false;
+  }
+  unsigned long number = strtoul(text, &end, base);
+  if (*end != '\0' || number > max) {
+    return false;
+  }
+  *value = (uint32_t)number;
+  return true;
+}
+
+// "0000fd6f-0000-1000-8000-00805f9b34fb" (dashes optional) -> 16 bytes little endian
+static bool parseUuid128(const char* text, uint8_t* uuid) {
+  size_t digits = 0;
+  for (; *text != '\0'; text++) {
+    if (*text == '-') {
+      continue;
+    }
+    int value = hexValue(*text);
+    if (value < 0 || digits >= 32) {
+      return false;
+    }
+    uint8_t& byte = uuid[15 - digits / 2];
+    byte = (digits % 2 == 0) ? (uint8_t)(value << 4) : (uint8_t)(byte | value);
+    digits++;
+  }
+  return digits == 32;
+}
+
+uint32_t SCANNER_HOT filterUuidKey(const uint8_t* uuid, size_t length) {
+  if (length == 2) {
+    return (uint32_t)(uuid[0] | (uuid[1] << 8));
+  }
+  if (length == 16 && memcmp(uuid, BASE_UUID, sizeof(BASE_UUID)) != 0) {
+    uint32_t hash = 2166136261u;   // FNV-1a
+    for (size_t i = 0; i < 16; i++) {
+      hash = (hash ^ uuid[i]) * 16777619u;
+    }
+    return (hash != 0) ? hash : 1;
+  }
+  const uint8_t* value = (length == 16) ? &uuid[12] : uuid;
+  return (uint32_t)value[0] | ((uint32_t)value[1] << 8) | ((uint32_t)value[2] << 16) | ((uint32_t)value[3] << 24);
+}
+
+bool filterRuleParse(const char* kind, const char* value, FilterRule* rule) {
+  if (kind == nullptr || value == nullptr) {
+    return false;
+  }
+  if (strcmp(kind, "company") == 0) {
+    rule->kind = FILTER_COMPANY;
+    return parseNumber(value, 0, AdvertFilter::COMPANY_IDS - 1, &rule->value);
+  }
+  if (strcmp(kind, "appearance") == 0) {
+    rule->kind = FILTER_APPEARANCE;
+    return parseNumber(value, 0, AdvertFilter::CATEGORIES - 1, &rule->value);
+  }
+  if (strcmp(kind, "uuid") == 0) {
+    rule->kind = FILTER_UUID;
+    uint8_t uuid[16];
+    if (parseUuid128(value, uuid)) {
+      rule->value = filterUuidKey(uuid, sizeof(uuid));
+      return true;
+    }
+    return parseNumber(value, 16, 0xFFFFFFFF, &rule->value) && rule->value != 0;
+  }
+  return false;
+}
+
+void filterRuleFormat(const FilterRule& rule, char* text, size_t size) {
+  switch (rule.kind) {
+    case FILTER_COMPANY:
+      snprintf(text, size, "company 0x%04lx", (unsigned long)rule.value);
+      break;
+    case FILTER_UUID:
+      snprintf(text, size, (rule.value <= 0xFFFF) ? "uuid %04lx" : "uuid %08lx", (unsigned long)rule.value);
+      break;
+    case FILTER_APPEARANCE:
+      snprintf(text, size, "appearance 0x%03lx", (unsigned long)rule.value);
+      break;
+    default:
+      snprintf(text, size, "?");
+      break;
+  }
+}
+
+bool AdvertFilterRules::add(const FilterRule& rule) {
+  for (size_t i = 0; i < m_count; i++) {
+    if (m_rules[i].kind == rule.kind && m_rules[i].value == rule.value) {
+      return true;
+    }
+  }
+  if (m_count >= CAPACITY) {
+    return false;
+  }
+  m_rules[m_count++] = rule;
+  return true;
+}
+
+bool AdvertFilterRules::remove(const FilterRule& rule) {
+  for (size_t i = 0; i < m_count; i++) {
+    if (m_rules[i].kind == rule.kind && m_rules[i].value == rule.value) {
+      m_rules[i] = m_rules[--m_count];
+      return true;
+    }
+  }
+  return false;
+}
+
+static inline size_t uuidSlot(uint32_t key, size_t mask) {
+  return (size_t)((key * 2654435761u) >> 16) & mask;
+}
+
+void AdvertFilter::compile(const AdvertFilterRules& rules) {
+  memset(m_companies, 0, sizeof(m_companies));
+  memset(m_categories, 0, sizeof(m_categories));
+  memset(m_uuids, 0, sizeof(m_uuids));
+  m_kinds = 0;
+
+  for (size_t i = 0; i < rules.size(); i++) {
+    const FilterRule& rule = rules.at(i);
+    if (rule.kind == FILTER_COMPANY && rule.value < COMPANY_IDS) {
+      m_companies[rule.value >> 5] |= 1u << (rule.value & 31);
+    } else if (rule.kind == FILTER_APPEARANCE && rule.value < CATEGORIES) {
+      m_categories[rule.value >> 5] |= 1u << (rule.value & 31);
+    } else if (rule.kind == FILTER_UUID && rule.value != 0) {
+      // At most CAPACITY of UUID_SLOTS slots are used, so a free slot always ends the probe
+      size_t slot = uuidSlot(rule.value, UUID_SLOTS - 1);
+      while (m_uuids[slot] != 0 && m_uuids[slot] != rule.value) {
+        slot = (slot + 1) & (UUID_SLOTS - 1);
+      }
+      m_uuids[slot] = rule.value;
+    } else {
+      continue;
+    }
+    m_kinds |= (uint8_t)(1 << rule.kind);
+  }
+}
+
+bool SCANNER_HOT AdvertFilter::hasUuid(uint32_t key) const {
+  size_t slot = uuidSlot(key, UUID_SLOTS - 1);
+  while (m_uuids[slot] != 0) {
+    if (m_uuids[slot] == key) {
+      return true;
+    }
+    slot = (slot + 1) & (UUID_SLOTS - 1);
+  }
+  return false;
+}
+
+bool SCANNER_HOT AdvertFilter::matches(const uint8_t* payload, size_t length) const {
+  if (m_kinds == 0) {
+    return true;
+  }
+
+  size_t pos = 0;
+  while (pos + 1 < length) {
+    uint8_t fieldLength = payload[pos];
+    if (fieldLength == 0 || pos + 1 + fieldLength > length) {
+      break;   // Padding or truncated structure
+    }
+    uint8_t type = payload[pos + 1];
+    const uint8_t* data = &payload[pos + 2];
+    size_t dataLength = fieldLength - 1;
+
+    // UUID lists hold uuidLength byte UUIDs, service data starts with one
+    size_t uuidLength = 0;
+    bool list = true;
+    switch (type) {
+      case AD_MANUFACTURER:
+        if (dataLength >= 2 && hasCompany((uint32_t)(data[0] | (data[1] << 8)))) {
+          return true;
+        }
+        break;
+
+      case AD_APPEARANCE:
+        if (dataLength >= 2) {
+          uint32_t category = (uint32_t)(data[0] | (data[1] << 8)) >> 6;
+          if ((m_categories[category >> 5] >> (category & 31)) & 1) {
+            return true;
+          }
+        }
+        break;
+
+      case AD_UUID16_INCOMPLETE:
+      case AD_UUID16_COMPLETE:
+        uuidLength = 2;
+        break;
+      case AD_UUID32_INCOMPLETE:
+      case AD_UUID32_COMPLETE:
+        uuidLength = 4;
+        break;
+      case AD_UUID128_INCOMPLETE:
+      case AD_UUID128_COMPLETE:
+        uuidLength = 16;
+        break;
+      case AD_SERVICE_DATA16:
+        uuidLength = 2;
+        list = false;
+        break;
+      case AD_SERVICE_DATA32:
+        uuidLength = 4;
+        list = false;
+        break;
+      case AD_SERVICE_DATA128:
+        uuidLength = 16;
+        list = false;
+        break;
+
+      default:
+        break;
+    }
+    for (size_t i = 0; uuidLength != 0 && i + uuidLength <= dataLength; i += uuidLength) {
+      if (hasUuid(filterUuidKey(&data[i], uuidLength))) {
+        return true;
+      }
+      if (!list) {
+        break;
+      }
+    }
+    pos += 1 + fieldLength;
+  }
+  return false;
+}
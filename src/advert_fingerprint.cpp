@@ -0,0 +1,114 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Advert payload fingerprint (FNV-1a over the stable AD fields)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "advert_fingerprint.h"
+#include "hot_path.h"
+
+// AD types (Bluetooth Assigned Numbers)
+static const uint8_t AD_FLAGS = 0x01;
+static const uint8_t AD_UUID16_INCOMPLETE = 0x02;
+static const uint8_t AD_UUID16_COMPLETE = 0x03;
+static const uint8_t AD_UUID128_INCOMPLETE = 0x06;
+static const uint8_t AD_UUID128_COMPLETE = 0x07;
+static const uint8_t AD_NAME_SHORT = 0x08;
+static const uint8_t AD_NAME_COMPLETE = 0x09;
+static const uint8_t AD_TX_POWER = 0x0A;
+static const uint8_t AD_APPEARANCE = 0x19;
+static const uint8_t AD_MANUFACTURER = 0xFF;
+
+static const uint32_t FNV_OFFSET = 2166136261u;
+static const uint32_t FNV_PRIME = 16777619u;
+
+static inline uint32_t fnv(uint32_t hash, const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ data[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+// Appearance category (appearance >> 6) -> typical TX power level, phones and unknown classes use the reference
+struct ClassTxPower {
+  uint16_t category;
+  int8_t txPower;
+};
+
+static const ClassTxPower CLASS_TX_POWER[] = {
+  { 0x003, 0 },    // Watch
+  { 0x008, -4 },   // Tag
+  { 0x009, -4 },   // Keyring
+  { 0x00D, -4 },   // Heart rate sensor
+  { 0x025, -2 },   // Wearable audio device (earbuds, headset, headphones)
+};
+
+int8_t SCANNER_HOT advertClassTxPower(uint16_t appearance) {
+  uint16_t category = appearance >> 6;
+  for (size_t i = 0; i < sizeof(CLASS_TX_POWER) / sizeof(CLASS_TX_POWER[0]); i++) {
+    if (CLASS_TX_POWER[i].category == category) {
+      return CLASS_TX_POWER[i].txPower;
+    }
+  }
+  return TX_POWER_UNKNOWN;
+}
+
+void SCANNER_HOT advertParse(const uint8_t* payload, size_t length, AdvertInfo* info) {
+  uint32_t hash = FNV_OFFSET;
+  bool used = false;
+  info->txPower = TX_POWER_UNKNOWN;
+  info->appearance = 0;
+
+  size_t pos = 0;
+  while (pos + 1 < length) {
+    uint8_t fieldLength = payload[pos];
+    if (fieldLength == 0 || pos + 1 + fieldLength > length) {
+      break;   // Padding or truncated structure
+    }
+    uint8_t type = payload[pos + 1];
+    const uint8_t* data = &payload[pos + 2];
+    size_t dataLength = fieldLength - 1;
+
+    if (type == AD_TX_POWER && dataLength >= 1) {
+      info->txPower = (int8_t)data[0];
+    } else if (type == AD_APPEARANCE && dataLength >= 2) {
+      info->appearance = (uint16_t)(data[0] | (data[1] << 8));
+    }
+
+    switch (type) {
+      case AD_FLAGS:
+      case AD_UUID16_INCOMPLETE:
+      case AD_UUID16_COMPLETE:
+      case AD_UUID128_INCOMPLETE:
+      case AD_UUID128_COMPLETE:
+      case AD_NAME_SHORT:
+      case AD_NAME_COMPLETE:
+      case AD_TX_POWER:
+      case AD_APPEARANCE:
+        hash = fnv(hash, &payload[pos + 1], fieldLength);
+        used = true;
+        break;
+
+      case AD_MANUFACTURER:
+        // Company ID and the (vendor specific) message type byte, the rest rotates with the address
+        hash = fnv(hash, &type, 1);
+        hash = fnv(hash, data, dataLength < 3 ? dataLength : 3);
+        used = true;
+        break;
+
+      default:
+        break;
+    }
+    pos += 1 + fieldLength;
+  }
+
+  if (!used) {
+    info->fingerprint = 0;
+  } else {
+    info->fingerprint = (hash != 0) ? hash : 1;
+  }
+}
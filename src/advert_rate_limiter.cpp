@@ -0,0 +1,41 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Host-side per-MAC advert rate limiter
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "advert_rate_limiter.h"
+#include "hot_path.h"
+
+// A real MAC never uses the upper 16 bits, so this can mark free slots
+static const MacKey EMPTY_SLOT = 0xFFFFFFFFFFFFFFFFULL;
+
+AdvertRateLimiter::AdvertRateLimiter() : m_intervalMs(0) {
+  clear();
+}
+
+void AdvertRateLimiter::clear() {
+  for (size_t i = 0; i < SLOTS; i++) {
+    m_addresses[i] = EMPTY_SLOT;
+    m_forwardedMs[i] = 0;
+  }
+  m_suppressed = 0;
+}
+
+bool SCANNER_HOT AdvertRateLimiter::allow(MacKey address, uint32_t nowMs) {
+  if (m_intervalMs == 0) {
+    return true;
+  }
+  size_t slot = (size_t)((address * 0x9E3779B97F4A7C15ULL) >> 40) & (SLOTS - 1);
+  if (m_addresses[slot] == address && nowMs - m_forwardedMs[slot] < m_intervalMs) {
+    m_suppressed++;
+    return false;
+  }
+  m_addresses[slot] = address;
+  m_forwardedMs[slot] = nowMs;
+  return true;
+}
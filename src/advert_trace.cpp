@@ -0,0 +1,72 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Advert trace format
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <string.h>
+
+#include "advert_trace.h"
+
+size_t traceWriteHeader(uint8_t* out) {
+  memcpy(out, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  out[4] = TRACE_VERSION;
+  return TRACE_HEADER_SIZE;
+}
+
+bool traceCheckHeader(const uint8_t* data, size_t length) {
+  return length >= TRACE_HEADER_SIZE && memcmp(data, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0 &&
+         data[4] == TRACE_VERSION;
+}
+
+size_t traceEncode(const ScanResult& result, uint32_t timeMs, bool payload, uint8_t* out) {
+  size_t payloadLength = result.payloadLength < TRACE_PAYLOAD_MAX ? result.payloadLength : TRACE_PAYLOAD_MAX;
+  if (!payload) {
+    payloadLength = 0;
+  }
+  out[0] = (uint8_t)timeMs;
+  out[1] = (uint8_t)(timeMs >> 8);
+  out[2] = (uint8_t)(timeMs >> 16);
+  out[3] = (uint8_t)(timeMs >> 24);
+  memcpy(&out[4], result.address, 6);
+  out[10] = result.addressType;
+  out[11] = (uint8_t)result.rssi;
+  out[12] = result.scanResponse ? TRACE_FLAG_SCAN_RESPONSE : 0;
+  out[13] = (uint8_t)payloadLength;
+  memcpy(&out[TRACE_RECORD_HEADER_SIZE], result.payload, payloadLength);
+  return TRACE_RECORD_HEADER_SIZE + payloadLength;
+}
+
+size_t traceDecode(const uint8_t* data, size_t length, TraceRecord* record) {
+  if (length < TRACE_RECORD_HEADER_SIZE) {
+    return 0;
+  }
+  size_t payloadLength = data[13];
+  if (payloadLength > TRACE_PAYLOAD_MAX || length < TRACE_RECORD_HEADER_SIZE + payloadLength) {
+    return 0;
+  }
+  record->timeMs = (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) |
+                   ((uint32_t)data[3] << 24);
+  memcpy(record->address, &data[4], 6);
+  record->addressType = data[10];
+  record->rssi = (int8_t)data[11];
+  record->flags = data[12];
+  record->payloadLength = (uint8_t)payloadLength;
+  memcpy(record->payload, &data[TRACE_RECORD_HEADER_SIZE], payloadLength);
+  return TRACE_RECORD_HEADER_SIZE + payloadLength;
+}
+
+ScanResult traceScanResult(const TraceRecord& record) {
+  ScanResult result;
+  result.address = record.address;
+  result.addressType = record.addressType;
+  result.rssi = record.rssi;
+  result.payload = record.payload;
+  result.payloadLength = record.payloadLength;
+  result.scanResponse = (record.flags & TRACE_FLAG_SCAN_RESPONSE) != 0;
+  return result;
+}
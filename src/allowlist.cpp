@@ -0,0 +1,146 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Known BLE device allowlist (open addressing with linear probing)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "allowlist.h"
+#include "hot_path.h"
+
+// A real MAC never uses the upper 16 bits, so this can mark free slots
+static const MacKey EMPTY_SLOT = 0xFFFFFFFFFFFFFFFFULL;
+
+static inline size_t hashKey(MacKey key, size_t mask) {
+  // 64-bit multiplicative hash, the upper bits are the best mixed
+  return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 40) & mask;
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+MacKey SCANNER_HOT macKeyFromBytes(const uint8_t* mac) {
+  MacKey key = 0;
+  for (int i = 0; i < 6; i++) {
+    key = (key << 8) | mac[i];
+  }
+  return key;
+}
+
+void macKeyToBytes(MacKey key, uint8_t* mac) {
+  for (int i = 5; i >= 0; i--) {
+    mac[i] = (uint8_t)(key & 0xFF);
+    key >>= 8;
+  }
+}
+
+bool macKeyFromString(const char* text, MacKey* key) {
+  MacKey value = 0;
+  for (int i = 0; i < 6; i++) {
+    int hi = hexValue(text[0]);
+    int lo = (hi < 0) ? -1 : hexValue(text[1]);
+    if (lo < 0) {
+      return false;
+    }
+    value = (value << 8) | (MacKey)((hi << 4) | lo);
+    text += 2;
+    if (i < 5) {
+      if (*text != ':' && *text != '-') {
+        return false;
+      }
+      text++;
+    }
+  }
+  if (*text != '\0') {
+    return false;
+  }
+  *key = value;
+  return true;
+}
+
+void macKeyToString(MacKey key, char* text) {
+  static const char digits[] = "0123456789abcdef";
+  uint8_t mac[6];
+  macKeyToBytes(key, mac);
+  for (int i = 0; i < 6; i++) {
+    *text++ = digits[mac[i] >> 4];
+    *text++ = digits[mac[i] & 0x0F];
+    *text++ = (i < 5) ? ':' : '\0';
+  }
+}
+
+Allowlist::Allowlist() {
+  clear();
+}
+
+void Allowlist::clear() {
+  for (size_t i = 0; i < SLOTS; i++) {
+    m_slots[i] = EMPTY_SLOT;
+  }
+  m_count = 0;
+}
+
+// Slot holding the key, or the free slot that ends its probe sequence
+size_t SCANNER_HOT Allowlist::findSlot(MacKey key) const {
+  size_t slot = hashKey(key, SLOTS - 1);
+  while (m_slots[slot] != EMPTY_SLOT && m_slots[slot] != key) {
+    slot = (slot + 1) & (SLOTS - 1);
+  }
+  return slot;
+}
+
+bool Allowlist::add(MacKey key) {
+  size_t slot = findSlot(key);
+  if (m_slots[slot] == key) {
+    return true;
+  }
+  if (m_count >= CAPACITY) {
+    return false;
+  }
+  m_slots[slot] = key;
+  m_count++;
+  return true;
+}
+
+bool Allowlist::remove(MacKey key) {
+  size_t slot = findSlot(key);
+  if (m_slots[slot] != key) {
+    return false;
+  }
+
+  // Backward shift deletion keeps every probe sequence intact without tombstones
+  size_t hole = slot;
+  size_t next = (hole + 1) & (SLOTS - 1);
+  while (m_slots[next] != EMPTY_SLOT) {
+    size_t home = hashKey(m_slots[next], SLOTS - 1);
+    if (((next - home) & (SLOTS - 1)) >= ((next - hole) & (SLOTS - 1))) {
+      m_slots[hole] = m_slots[next];
+      hole = next;
+    }
+    next = (next + 1) & (SLOTS - 1);
+  }
+  m_slots[hole] = EMPTY_SLOT;
+  m_count--;
+  return true;
+}
+
+bool SCANNER_HOT Allowlist::contains(MacKey key) const {
+  return m_slots[findSlot(key)] == key;
+}
+
+size_t Allowlist::copyTo(MacKey* keys, size_t maxKeys) const {
+  size_t n = 0;
+  for (size_t i = 0; i < SLOTS && n < maxKeys; i++) {
+    if (m_slots[i] != EMPTY_SLOT) {
+      keys[n++] = m_slots[i];
+    }
+  }
+  return n;
+}
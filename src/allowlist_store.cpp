@@ -0,0 +1,69 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Persistent storage of the known device allowlist in NVS
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#include "allowlist_store.h"
+
+static const char* NVS_NAMESPACE = "scanner";
+static const char* NVS_KEY_ALLOWLIST = "allow";
+static const uint8_t ALLOWLIST_BLOB_VERSION = 1;  // Blob layout: [version][6 bytes per address]...
+
+bool allowlistLoad(Allowlist& list) {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, true)) {
+    return false;
+  }
+
+  uint8_t blob[1 + Allowlist::CAPACITY * 6];
+  size_t length = prefs.getBytesLength(NVS_KEY_ALLOWLIST);
+  bool valid = length >= 1 && length <= sizeof(blob) && (length - 1) % 6 == 0 &&
+               prefs.getBytes(NVS_KEY_ALLOWLIST, blob, length) == length &&
+               blob[0] == ALLOWLIST_BLOB_VERSION;
+  prefs.end();
+  if (!valid) {
+    return false;
+  }
+
+  // An empty stored list is valid (freshly installed, nothing known yet)
+  list.clear();
+  for (size_t i = 1; i < length; i += 6) {
+    list.add(macKeyFromBytes(&blob[i]));
+  }
+  return true;
+}
+
+bool allowlistSave(const Allowlist& list) {
+  MacKey keys[Allowlist::CAPACITY];
+  uint8_t blob[1 + Allowlist::CAPACITY * 6];
+  size_t count = list.copyTo(keys, Allowlist::CAPACITY);
+  blob[0] = ALLOWLIST_BLOB_VERSION;
+  for (size_t i = 0; i < count; i++) {
+    macKeyToBytes(keys[i], &blob[1 + i * 6]);
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, false)) {
+    return false;
+  }
+  size_t length = 1 + count * 6;
+  bool ok = prefs.putBytes(NVS_KEY_ALLOWLIST, blob, length) == length;
+  prefs.end();
+  return ok;
+}
+
+void allowlistErase() {
+  Preferences prefs;
+  if (prefs.begin(NVS_NAMESPACE, false)) {
+    prefs.remove(NVS_KEY_ALLOWLIST);
+    prefs.end();
+  }
+}
@@ -0,0 +1,72 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Audience estimator (rotating address merging, presence table, mode state machine)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "audience_estimator.h"
+
+// Random address that is not static => the device may replace it at any time (resolvable / non-resolvable private)
+static bool isRotatingAddress(const DeviceRecord& record) {
+  return record.addressType == ADDRESS_TYPE_RANDOM && ((record.address >> 46) & 0x03) != 0x03;
+}
+
+AudienceEstimator::AudienceEstimator()
+    : m_merged(nullptr), m_rotationMinGap(1000), m_rotationRssiTolerance(10), m_retiredMemory(60000), m_retiredRotateMs(0) {}
+
+void AudienceEstimator::configure(const ScannerConfig& config) {
+  RssiFilterConfig filter;
+  filter.processNoise = config.rssiProcessNoise;
+  filter.measurementNoise = config.rssiMeasurementNoise;
+  filter.txPowerReference = config.txPowerReference;
+  m_presence.configure(config.presenceTtl, filter);
+  m_presence.setThresholds(config.rssiThreshold, config.rssiThresholdFootstep);
+
+  AudienceModeConfig modes = m_mode.config();
+  modes.thresholds[AUDIENCE_SMALL - 1].enter = config.audienceSmallEnter;
+  modes.thresholds[AUDIENCE_SMALL - 1].exit = config.audienceSmallExit;
+  modes.thresholds[AUDIENCE_LARGE - 1].enter = config.audienceLargeEnter;
+  modes.thresholds[AUDIENCE_LARGE - 1].exit = config.audienceLargeExit;
+  for (int i = AUDIENCE_FEW; i < AUDIENCE_LEVELS; i++) {
+    modes.dwellMs[i] = config.modeMinDwell;
+  }
+  m_mode.configure(modes);
+  m_trend.configure(config.trendWindow);
+
+  m_rotationMinGap = config.rotationMinGap;
+  m_rotationRssiTolerance = config.rotationRssiTolerance;
+  m_retiredMemory = config.retiredMemory;
+}
+
+// A new rotating address that continues a device which just went quiet is counted as that device
+void AudienceEstimator::add(const DeviceRecord& record, bool* isNew) {
+  *isNew = false;
+  bool rotating = isRotatingAddress(record);
+  if (rotating && m_retired.contains(record.address)) {
+    return;  // Late advert of an address the device already rotated away from
+  }
+  m_presence.update(record, isNew);
+
+  MacKey retired;
+  if (rotating && m_presence.mergeRotation(record.address, record.timeMs, m_rotationMinGap,
+                                           m_rotationRssiTolerance, &retired)) {
+    m_retired.add(retired);
+    *isNew = false;
+  }
+}
+
+// A new device raises the mode after the dwell time of the current mode, a device that left drops out
+// when its entry ages out. Counts between the enter and exit threshold of a mode keep the mode
+bool AudienceEstimator::update(uint32_t nowMs) {
+  m_presence.expire(nowMs);
+  if (nowMs - m_retiredRotateMs >= m_retiredMemory) {
+    m_retiredRotateMs = nowMs;
+    m_retired.rotate();
+  }
+  m_trend.update(nowMs, m_presence.arrivals(), m_presence.departures(), m_presence.dwellTotalMs());
+  return m_mode.update(nowMs, count());
+}
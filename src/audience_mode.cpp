@@ -0,0 +1,54 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Audience mode state machine (hysteresis thresholds, minimum dwell time)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "audience_mode.h"
+
+AudienceMode::AudienceMode() : m_level(AUDIENCE_NONE), m_enteredMs(0), m_transitions(0) {
+  // 1..4 devices -> 'r', 5..15 -> 'f', 16 and more -> 'r' (the original buckets), 2 devices of hysteresis
+  AudienceModeConfig config = {
+    { { 1, 1 }, { 5, 4 }, { 16, 14 } },
+    { 0, 3000, 3000, 3000 },
+    { 's', 'r', 'f', 'r' }
+  };
+  m_config = config;
+}
+
+void AudienceMode::configure(const AudienceModeConfig& config) {
+  m_config = config;
+  for (int i = 0; i < AUDIENCE_LEVELS - 1; i++) {
+    if (m_config.thresholds[i].exit > m_config.thresholds[i].enter) {
+      m_config.thresholds[i].exit = m_config.thresholds[i].enter;
+    }
+  }
+}
+
+// Highest level whose enter threshold is reached, then down while below the exit threshold
+// Between the two thresholds of a boundary the current level holds
+AudienceLevel AudienceMode::targetLevel(int count) const {
+  int level = m_level;
+  while (level < AUDIENCE_LEVELS - 1 && count >= (int)m_config.thresholds[level].enter) {
+    level++;
+  }
+  while (level > AUDIENCE_NONE && count < (int)m_config.thresholds[level - 1].exit) {
+    level--;
+  }
+  return (AudienceLevel)level;
+}
+
+bool AudienceMode::update(uint32_t nowMs, int count) {
+  AudienceLevel target = targetLevel(count);
+  if (target == m_level || nowMs - m_enteredMs < m_config.dwellMs[m_level]) {
+    return false;
+  }
+  m_level = target;
+  m_enteredMs = nowMs;
+  m_transitions++;
+  return true;
+}
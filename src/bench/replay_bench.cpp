@@ -0,0 +1,303 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Replay benchmark of the scanner logic (native environment)
+  * Feeds an advert trace through the same path as the sketch: allowlist, advert filter (configured rules,
+  * none by default), rate limiter, scan queue, record classification, stationary learner while calibrating,
+  * audience estimator. Reports the cost per advert, the memory used and how often the audience mode changed.
+  *
+  *   pio run -e native && .pio/build/native/program [trace.blet]
+  *   A trace is recorded on the device with "trace start" / "trace dump" (see trace_recorder.h).
+  *   Without a trace file a synthetic venue is replayed (see trace_synth.h), its stationary devices are
+  *   on the allowlist, or learned by a calibration over the first -c seconds. The venue is shaped by
+  *   -d <visitors> -f <stationary> -s <seconds> -t <mean stay s> -r <rotation s> -S <seed> -c <calibration s>
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <new>
+#include <vector>
+
+#include "advert_filter.h"
+#include "advert_rate_limiter.h"
+#include "advert_trace.h"
+#include "allowlist.h"
+#include "audience_estimator.h"
+#include "device_record.h"
+#include "ring_buffer.h"
+#include "scanner_config.h"
+#include "stationary_learner.h"
+#include "trace_synth.h"
+
+static const uint32_t AGGREGATION_PERIOD_MS = 20;   // Same as AGGREGATION_TASK_PERIOD of the sketch
+static const uint32_t FLAP_WINDOW_MS = 30000;       // Mode change back within this time -> flap
+
+// ***** Heap use during the replay (the scanner path must not allocate) ***** //
+static size_t heapAllocations = 0;
+static size_t heapBytes = 0;
+static bool countHeap = false;
+
+void* operator new(size_t size) {
+  if (countHeap) {
+    heapAllocations++;
+    heapBytes += size;
+  }
+  void* memory = malloc(size > 0 ? size : 1);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  free(memory);
+}
+
+// Pipeline state, static like in the sketch
+static ScannerConfig config;
+static Allowlist allowlist;
+static AdvertFilter advertFilter;
+static AdvertRateLimiter advertLimiter;
+static RingBuffer<DeviceRecord, 512> scanQueue;
+static StationaryLearner stationaryLearner;
+static AudienceEstimator audience;
+
+struct ReplayStats {
+  uint32_t adverts;
+  uint32_t filtered;
+  uint32_t forwarded;
+  uint32_t learned;
+  size_t peakTracked;
+  size_t peakQueued;
+  uint32_t transitions;
+  uint32_t flaps;
+  uint32_t durationMs;
+  uint16_t peakArrivalRate;
+  uint16_t peakDepartureRate;
+};
+
+// Appends the records of a trace file (a recorder dump can hold several files, each with a header)
+static bool loadTrace(const char* path, std::vector<uint8_t>& trace) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buffer[4096];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + length);
+  }
+  fclose(file);
+
+  if (!traceCheckHeader(data.data(), data.size())) {
+    return false;
+  }
+  // A record starting with the header bytes would need an uptime of 16 days, so a header always wins
+  size_t offset = 0;
+  while (offset < data.size()) {
+    if (traceCheckHeader(&data[offset], data.size() - offset)) {
+      offset += TRACE_HEADER_SIZE;
+      continue;
+    }
+    TraceRecord record;
+    size_t used = traceDecode(&data[offset], data.size() - offset, &record);
+    if (used == 0) {
+      break;   // Truncated last record
+    }
+    trace.insert(trace.end(), data.begin() + offset, data.begin() + offset + used);
+    offset += used;
+  }
+  return true;
+}
+
+// Drain the queue and decide the mode, as the aggregation task does every AGGREGATION_PERIOD_MS
+static void aggregate(uint32_t nowMs, ReplayStats& stats, char* lastMode, uint32_t* lastChangeMs, char* previousMode) {
+  size_t queued = scanQueue.count();
+  if (queued > stats.peakQueued) {
+    stats.peakQueued = queued;
+  }
+  DeviceRecord record;
+  while (scanQueue.pop(record)) {
+    if (stationaryLearner.running()) {
+      stationaryLearner.add(record);
+    } else if (!record.known) {
+      bool isNew;
+      audience.add(record, &isNew);
+    }
+  }
+  if (stationaryLearner.finished(nowMs)) {
+    stats.learned = (uint32_t)stationaryLearner.result(allowlist, config.calibrationPresence,
+                                                       config.calibrationRssiSpread);
+    stationaryLearner.stop();
+  }
+  bool changed = audience.update(nowMs);
+  const OccupancyTrend& trend = audience.trend();
+  if (trend.arrivalRate() > stats.peakArrivalRate) {
+    stats.peakArrivalRate = trend.arrivalRate();
+  }
+  if (trend.departureRate() > stats.peakDepartureRate) {
+    stats.peakDepartureRate = trend.departureRate();
+  }
+  if (changed) {
+    char mode = audience.message();
+    stats.transitions++;
+    if (mode == *previousMode && nowMs - *lastChangeMs < FLAP_WINDOW_MS) {
+      stats.flaps++;
+    }
+    *previousMode = *lastMode;
+    *lastMode = mode;
+    *lastChangeMs = nowMs;
+  }
+  if (audience.presence().size() > stats.peakTracked) {
+    stats.peakTracked = audience.presence().size();
+  }
+}
+
+static void replay(const std::vector<uint8_t>& trace, ReplayStats& stats) {
+  char lastMode = audience.message();
+  char previousMode = lastMode;
+  uint32_t lastChangeMs = 0;
+  uint32_t nextAggregationMs = AGGREGATION_PERIOD_MS;
+  uint32_t timeMs = 0;
+
+  size_t pos = 0;
+  TraceRecord record;
+  size_t size;
+  while (pos < trace.size() && (size = traceDecode(trace.data() + pos, trace.size() - pos, &record)) > 0) {
+    pos += size;
+    timeMs = record.timeMs;
+    while ((int32_t)(timeMs - nextAggregationMs) >= 0) {
+      aggregate(nextAggregationMs, stats, &lastMode, &lastChangeMs, &previousMode);
+      nextAggregationMs += AGGREGATION_PERIOD_MS;
+    }
+
+    // ***** Scan callback ***** //
+    stats.adverts++;
+    ScanResult result = traceScanResult(record);
+    MacKey address = macKeyFromBytes(result.address);
+    bool known = allowlist.contains(address);
+    if (known && !stationaryLearner.running()) {
+      continue;
+    }
+    if (!advertFilter.matches(result.payload, result.payloadLength)) {
+      stats.filtered++;
+      continue;
+    }
+    if (!advertLimiter.allow(address, timeMs)) {
+      continue;
+    }
+    DeviceRecord* queued = scanQueue.acquire();
+    if (queued == nullptr) {
+      continue;
+    }
+    deviceRecordFill(*queued, result, address, known, timeMs);
+    scanQueue.commit();
+    stats.forwarded++;
+  }
+  aggregate(nextAggregationMs, stats, &lastMode, &lastChangeMs, &previousMode);
+  stats.durationMs = timeMs;
+}
+
+// Synthetic venue options, false on an unknown option
+static bool parseSynthOptions(int argc, char** argv, SynthConfig& synth, uint32_t* calibrationMs) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    uint32_t value = (uint32_t)strtoul(argv[i + 1], nullptr, 0);
+    if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0') {
+      return false;
+    }
+    switch (argv[i][1]) {
+      case 'd': synth.devices = value; break;
+      case 'f': synth.stationary = value; break;
+      case 's': synth.durationMs = value * 1000; break;
+      case 't': synth.meanStayMs = value * 1000; break;
+      case 'r': synth.rotationMs = value * 1000; break;
+      case 'S': synth.seed = value; break;
+      case 'c': *calibrationMs = value * 1000; break;
+      default: return false;
+    }
+  }
+  return (argc % 2) == 1;
+}
+
+int main(int argc, char** argv) {
+  std::vector<uint8_t> trace;
+  std::vector<MacKey> stationary;
+  uint32_t calibrationMs = 0;
+  if (argc == 2) {
+    if (!loadTrace(argv[1], trace)) {
+      fprintf(stderr, "%s: not a readable trace file\n", argv[1]);
+      return 1;
+    }
+    printf("Trace        : %s (%u bytes)\n", argv[1], (unsigned)trace.size());
+  } else {
+    SynthConfig synth;
+    synthDefaults(synth);
+    if (!parseSynthOptions(argc, argv, synth, &calibrationMs)) {
+      fprintf(stderr, "usage: %s [trace.blet] | [-d visitors] [-f stationary] [-s seconds] [-t stay] [-r rotation] [-S seed]"
+              " [-c calibration]\n", argv[0]);
+      return 1;
+    }
+    synthTrace(synth, trace, stationary);
+    for (size_t i = 0; calibrationMs == 0 && i < stationary.size(); i++) {
+      allowlist.add(stationary[i]);   // As learned by a calibration of the empty venue
+    }
+    printf("Trace        : synthetic, %u visitors + %u stationary over %u s (%u bytes)\n",
+           (unsigned)synth.devices, (unsigned)synth.stationary, (unsigned)(synth.durationMs / 1000),
+           (unsigned)trace.size());
+  }
+
+  configDefaults(config);
+  advertLimiter.setInterval(config.advertRateLimit);
+  audience.configure(config);
+  if (calibrationMs > 0) {
+    stationaryLearner.begin(0, calibrationMs);
+  }
+
+  ReplayStats stats = {};
+  countHeap = true;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  replay(trace, stats);
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  countHeap = false;
+
+  double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  double minutes = stats.durationMs / 60000.0;
+  printf("Adverts      : %u (%u forwarded, %u filtered, %u rate limited, %u queue drops)\n", (unsigned)stats.adverts,
+         (unsigned)stats.forwarded, (unsigned)stats.filtered, (unsigned)advertLimiter.suppressed(),
+         (unsigned)scanQueue.dropped());
+  printf("Cost         : %.1f ns/advert (%.1f ms total)\n", stats.adverts > 0 ? ns / stats.adverts : 0.0, ns / 1e6);
+  printf("Memory       : %u bytes static (allowlist %u, filter %u, rate limiter %u, scan queue %u, learner %u, estimator %u)\n",
+         (unsigned)(sizeof(allowlist) + sizeof(advertFilter) + sizeof(advertLimiter) + sizeof(scanQueue) +
+                    sizeof(stationaryLearner) + sizeof(audience)),
+         (unsigned)sizeof(allowlist), (unsigned)sizeof(advertFilter), (unsigned)sizeof(advertLimiter),
+         (unsigned)sizeof(scanQueue), (unsigned)sizeof(stationaryLearner), (unsigned)sizeof(audience));
+  if (calibrationMs > 0) {
+    size_t found = 0;
+    for (size_t i = 0; i < stationary.size(); i++) {
+      found += allowlist.contains(stationary[i]) ? 1 : 0;
+    }
+    printf("Calibration  : %u devices learned in %u s (%u of %u stationary), %u candidates\n",
+           (unsigned)stats.learned, (unsigned)(calibrationMs / 1000), (unsigned)found,
+           (unsigned)stationary.size(), (unsigned)stationaryLearner.candidates());
+  }
+  printf("High water   : %u / %u tracked devices, %u / 512 queued records, %u heap allocations (%u bytes)\n",
+         (unsigned)stats.peakTracked, (unsigned)PresenceTable::CAPACITY, (unsigned)stats.peakQueued,
+         (unsigned)heapAllocations, (unsigned)heapBytes);
+  printf("Presence     : %u evictions, %u address rotations merged\n",
+         (unsigned)audience.presence().evictions(), (unsigned)audience.presence().takeovers());
+  const PresenceTable& presence = audience.presence();
+  printf("Trend        : %u arrivals, %u departures (peak %.1f / %.1f per min), mean dwell %u s (average %.1f s)\n",
+         (unsigned)presence.arrivals(), (unsigned)presence.departures(), stats.peakArrivalRate / 10.0,
+         stats.peakDepartureRate / 10.0, (unsigned)audience.trend().meanDwell(),
+         presence.departures() > 0 ? presence.dwellTotalMs() / 1000.0 / presence.departures() : 0.0);
+  printf("Mode         : %u transitions, %u flaps (back within %u s), %.1f transitions/min\n",
+         (unsigned)stats.transitions, (unsigned)stats.flaps, (unsigned)(FLAP_WINDOW_MS / 1000),
+         minutes > 0 ? stats.transitions / minutes : 0.0);
+  return 0;
+}
@@ -0,0 +1,156 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Synthetic venue trace for the replay benchmark
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <queue>
+
+#include "trace_synth.h"
+#include "advert_trace.h"
+#include "rssi_filter.h"
+
+// Deterministic PRNG (xorshift32), the same seed gives the same trace on every host
+class Random {
+public:
+  explicit Random(uint32_t seed) : m_state(seed != 0 ? seed : 1) {}
+  uint32_t next() {
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    return m_state;
+  }
+  uint32_t below(uint32_t n) { return n > 0 ? next() % n : 0; }
+  int noise(int spread) { return (int)below(2 * spread + 1) - spread; }
+
+private:
+  uint32_t m_state;
+};
+
+struct Device {
+  uint8_t address[6];
+  uint8_t addressType;
+  bool stationary;
+  uint32_t leaveMs;
+  uint32_t rotateMs;
+  uint16_t intervalMs;     // Advertising interval
+  int rssi;                // Slowly walking mean RSSI
+  int8_t txPower;          // TX power level AD field, TX_POWER_UNKNOWN -> not advertised
+  uint8_t payloadType;     // Manufacturer message type, stable across rotations
+};
+
+struct Event {
+  uint32_t timeMs;
+  uint32_t device;
+  bool operator<(const Event& other) const { return timeMs > other.timeMs; }  // Earliest first
+};
+
+static void newPrivateAddress(Random& random, Device& device) {
+  for (int i = 0; i < 6; i++) {
+    device.address[i] = (uint8_t)random.next();
+  }
+  device.address[0] = (uint8_t)((device.address[0] & 0x3F) | 0x40);  // Resolvable private address
+  device.addressType = 1;
+}
+
+void synthDefaults(SynthConfig& config) {
+  config.devices = 2000;
+  config.stationary = 20;
+  config.durationMs = 1200000;
+  config.meanStayMs = 60000;
+  config.rotationMs = 90000;
+  config.seed = 1;
+}
+
+void synthTrace(const SynthConfig& config, std::vector<uint8_t>& trace, std::vector<MacKey>& stationary) {
+  Random random(config.seed);
+  std::vector<Device> devices(config.stationary + config.devices);
+  std::priority_queue<Event> events;
+
+  for (uint32_t i = 0; i < devices.size(); i++) {
+    Device& device = devices[i];
+    device.stationary = i < config.stationary;
+    uint32_t arriveMs = 0;
+    if (device.stationary) {
+      for (int b = 0; b < 6; b++) {
+        device.address[b] = (uint8_t)random.next();
+      }
+      device.address[0] &= 0xFC;
+      device.addressType = 0;
+      device.leaveMs = config.durationMs;
+      device.rotateMs = 0xFFFFFFFF;
+      device.intervalMs = (uint16_t)(100 + random.below(900));
+      device.rssi = -60 - (int)random.below(30);
+      stationary.push_back(macKeyFromBytes(device.address));
+    } else {
+      newPrivateAddress(random, device);
+      arriveMs = random.below(config.durationMs);
+      device.leaveMs = arriveMs + config.meanStayMs / 4 + random.below(config.meanStayMs * 3 / 2);
+      device.rotateMs = arriveMs + random.below(config.rotationMs);
+      device.intervalMs = (uint16_t)(100 + random.below(400));
+      device.rssi = -45 - (int)random.below(50);
+    }
+    device.txPower = (random.below(3) == 0) ? (int8_t)((int)random.below(20) - 8) : TX_POWER_UNKNOWN;
+    device.payloadType = (uint8_t)random.below(16);
+    Event event = { arriveMs, i };
+    events.push(event);
+  }
+
+  uint8_t payload[TRACE_PAYLOAD_MAX];
+  uint8_t record[TRACE_RECORD_MAX];
+  while (!events.empty()) {
+    Event event = events.top();
+    events.pop();
+    Device& device = devices[event.device];
+    if (event.timeMs >= device.leaveMs || event.timeMs >= config.durationMs) {
+      continue;
+    }
+    if (event.timeMs >= device.rotateMs) {
+      newPrivateAddress(random, device);
+      device.rotateMs += config.rotationMs;
+    }
+
+    // Flags + manufacturer data (company, stable type byte, rotating rest) + optional TX power
+    size_t length = 0;
+    payload[length++] = 2;
+    payload[length++] = 0x01;
+    payload[length++] = 0x1A;
+    payload[length++] = 8;
+    payload[length++] = 0xFF;
+    payload[length++] = 0x4C;
+    payload[length++] = 0x00;
+    payload[length++] = device.payloadType;
+    for (int b = 0; b < 4; b++) {
+      payload[length++] = (uint8_t)random.next();
+    }
+    if (device.txPower != TX_POWER_UNKNOWN) {
+      payload[length++] = 2;
+      payload[length++] = 0x0A;
+      payload[length++] = (uint8_t)device.txPower;
+    }
+
+    // Walk the mean RSSI (people move), then add fading and a deep fade now and then
+    if (!device.stationary) {
+      device.rssi += random.noise(1);
+      device.rssi = device.rssi > -35 ? -35 : device.rssi < -100 ? -100 : device.rssi;
+    }
+    int rssi = device.rssi + random.noise(4) - (random.below(20) == 0 ? 15 : 0);
+
+    ScanResult result;
+    result.address = device.address;
+    result.addressType = device.addressType;
+    result.rssi = (int8_t)(rssi < -127 ? -127 : rssi);
+    result.payload = payload;
+    result.payloadLength = (uint8_t)length;
+    result.scanResponse = false;
+    size_t size = traceEncode(result, event.timeMs, true, record);
+    trace.insert(trace.end(), record, record + size);
+
+    event.timeMs += device.intervalMs + random.below(10);   // Advertising delay 0..10 ms
+    events.push(event);
+  }
+}
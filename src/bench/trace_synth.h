@@ -0,0 +1,33 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Synthetic venue trace for the replay benchmark
+  * Visitors arrive and leave over the trace, advertise from rotating private addresses with fading RSSI,
+  * and a few stationary devices (public addresses, steady RSSI) advertise the whole time.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "allowlist.h"
+
+struct SynthConfig {
+  uint32_t devices;          // Visitors over the whole trace
+  uint32_t stationary;       // Devices present the whole time
+  uint32_t durationMs;
+  uint32_t meanStayMs;       // Average visit
+  uint32_t rotationMs;       // Private address rotation period
+  uint32_t seed;
+};
+
+void synthDefaults(SynthConfig& config);
+
+// Appends the encoded trace records (without the file header) in time order, stationary receives the
+// addresses a calibration would have learned
+void synthTrace(const SynthConfig& config, std::vector<uint8_t>& trace, std::vector<MacKey>& stationary);
@@ -0,0 +1,64 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Persistent storage of the scanner configuration in NVS
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#include "config_store.h"
+
+static const char* NVS_NAMESPACE = "scanner";
+static const char* NVS_KEY_CONFIG = "config";
+static const uint8_t CONFIG_BLOB_VERSION = 8;  // Blob layout: [version][ScannerConfig], bump on any layout change
+
+bool configLoad(ScannerConfig& config) {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, true)) {
+    return false;
+  }
+
+  uint8_t blob[1 + sizeof(ScannerConfig)];
+  bool valid = prefs.getBytesLength(NVS_KEY_CONFIG) == sizeof(blob) &&
+               prefs.getBytes(NVS_KEY_CONFIG, blob, sizeof(blob)) == sizeof(blob) &&
+               blob[0] == CONFIG_BLOB_VERSION;
+  prefs.end();
+  if (!valid) {
+    return false;
+  }
+
+  ScannerConfig stored;
+  memcpy(&stored, &blob[1], sizeof(stored));
+  if (!configValid(stored)) {
+    return false;
+  }
+  config = stored;
+  return true;
+}
+
+bool configSave(const ScannerConfig& config) {
+  uint8_t blob[1 + sizeof(ScannerConfig)];
+  blob[0] = CONFIG_BLOB_VERSION;
+  memcpy(&blob[1], &config, sizeof(config));
+
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, false)) {
+    return false;
+  }
+  bool ok = prefs.putBytes(NVS_KEY_CONFIG, blob, sizeof(blob)) == sizeof(blob);
+  prefs.end();
+  return ok;
+}
+
+void configErase() {
+  Preferences prefs;
+  if (prefs.begin(NVS_NAMESPACE, false)) {
+    prefs.remove(NVS_KEY_CONFIG);
+    prefs.end();
+  }
+}
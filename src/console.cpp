@@ -0,0 +1,187 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Serial command console
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "console.h"
+#include "config_store.h"
+#include "allowlist_store.h"
+#include "filter_store.h"
+
+Console::Console(ScannerConfig& config, Allowlist& allowlist, AdvertFilterRules& filterRules)
+    : m_config(config), m_allowlist(allowlist), m_filterRules(filterRules), m_length(0) {}
+
+uint16_t Console::poll(Stream& stream) {
+  uint16_t changes = CONSOLE_NONE;
+  while (stream.available() > 0) {
+    char c = (char)stream.read();
+    if (c == '\r' || c == '\n') {
+      if (m_length > 0) {
+        m_line[m_length] = '\0';
+        m_length = 0;
+        changes |= execute(m_line, stream);
+      }
+    } else if (m_length < LINE_SIZE - 1) {
+      m_line[m_length++] = c;
+    }
+  }
+  return changes;
+}
+
+void Console::printField(Print& out, size_t field) {
+  out.printf("%s = %ld%s\n", configFieldName(field), (long)configFieldGet(m_config, field),
+             configFieldIsBoot(field) ? " (boot)" : "");
+}
+
+uint16_t Console::execute(char* line, Print& out) {
+  char* context = nullptr;
+  const char* command = strtok_r(line, " \t", &context);
+  const char* arg1 = strtok_r(nullptr, " \t", &context);
+  const char* arg2 = strtok_r(nullptr, " \t", &context);
+  const char* arg3 = strtok_r(nullptr, " \t", &context);
+  if (command == nullptr) {
+    return CONSOLE_NONE;   // Only blanks on the line
+  }
+
+  // ***** Configuration ***** //
+  if (strcmp(command, "get") == 0) {
+    size_t field;
+    if (arg1 == nullptr) {
+      for (field = 0; field < configFieldCount(); field++) {
+        printField(out, field);
+      }
+    } else if (configFieldFind(arg1, &field)) {
+      printField(out, field);
+    } else {
+      out.printf("unknown field %s\n", arg1);
+    }
+    return CONSOLE_NONE;
+  }
+  if (strcmp(command, "set") == 0) {
+    size_t field;
+    if (arg1 == nullptr || arg2 == nullptr || !configFieldFind(arg1, &field)) {
+      out.println("usage: set <field> <value>");
+      return CONSOLE_NONE;
+    }
+    char* end = nullptr;
+    long value = strtol(arg2, &end, 0);
+    ScannerConfig changed = m_config;
+    if (end == arg2 || *end != '\0' || !configFieldSet(changed, field, (int32_t)value) || !configValid(changed)) {
+      out.printf("invalid value for %s\n", arg1);
+      return CONSOLE_NONE;
+    }
+    m_config = changed;
+    printField(out, field);
+    return CONSOLE_CONFIG;
+  }
+  if (strcmp(command, "defaults") == 0) {
+    configDefaults(m_config);
+    out.println("defaults loaded (not saved)");
+    return CONSOLE_CONFIG;
+  }
+  if (strcmp(command, "save") == 0) {
+    bool ok = configSave(m_config) && allowlistSave(m_allowlist) && filterRulesSave(m_filterRules);
+    out.println(ok ? "saved" : "save failed");
+    return CONSOLE_NONE;
+  }
+
+  // ***** Known device allowlist ***** //
+  if (strcmp(command, "allow") == 0) {
+    MacKey key;
+    char text[18];
+    if (arg1 == nullptr) {
+      MacKey keys[Allowlist::CAPACITY];
+      size_t count = m_allowlist.copyTo(keys, Allowlist::CAPACITY);
+      for (size_t i = 0; i < count; i++) {
+        macKeyToString(keys[i], text);
+        out.println(text);
+      }
+      out.printf("%u known devices\n", (unsigned)count);
+      return CONSOLE_NONE;
+    }
+    if (arg2 == nullptr || !macKeyFromString(arg2, &key)) {
+      out.println("usage: allow [add|remove <mac>]");
+      return CONSOLE_NONE;
+    }
+    bool ok = false;
+    if (strcmp(arg1, "add") == 0) {
+      ok = m_allowlist.add(key);
+    } else if (strcmp(arg1, "remove") == 0) {
+      ok = m_allowlist.remove(key);
+    }
+    out.println(ok ? "ok" : "failed");
+    return ok ? CONSOLE_ALLOWLIST : CONSOLE_NONE;
+  }
+
+  // ***** Advert filter ***** //
+  if (strcmp(command, "filter") == 0) {
+    FilterRule rule;
+    char text[24];
+    if (arg1 == nullptr) {
+      for (size_t i = 0; i < m_filterRules.size(); i++) {
+        filterRuleFormat(m_filterRules.at(i), text, sizeof(text));
+        out.println(text);
+      }
+      out.printf("%u rules%s\n", (unsigned)m_filterRules.size(), (m_filterRules.size() == 0) ? ", every advert is counted" : "");
+      return CONSOLE_NONE;
+    }
+    if (strcmp(arg1, "clear") == 0) {
+      m_filterRules.clear();
+      out.println("ok");
+      return CONSOLE_FILTER;
+    }
+    if (!filterRuleParse(arg2, arg3, &rule)) {
+      out.println("usage: filter [add|remove <company|uuid|appearance> <value> | clear]");
+      return CONSOLE_NONE;
+    }
+    bool ok = false;
+    if (strcmp(arg1, "add") == 0) {
+      ok = m_filterRules.add(rule);
+    } else if (strcmp(arg1, "remove") == 0) {
+      ok = m_filterRules.remove(rule);
+    }
+    out.println(ok ? "ok" : "failed");
+    return ok ? CONSOLE_FILTER : CONSOLE_NONE;
+  }
+
+  // ***** Calibration ***** //
+  if (strcmp(command, "calibrate") == 0) {
+    out.printf("calibrating for %u minutes, keep the venue empty\n", (unsigned)m_config.calibrationMinutes);
+    return CONSOLE_CALIBRATE;
+  }
+
+  // ***** Telemetry ***** //
+  if (strcmp(command, "stats") == 0) {
+    if (arg1 != nullptr && strcmp(arg1, "reset") == 0) {
+      out.println("ok");
+      return CONSOLE_STATS_RESET;
+    }
+    return CONSOLE_STATS;
+  }
+
+  // ***** Trace recording ***** //
+  if (strcmp(command, "trace") == 0 && arg1 != nullptr) {
+    if (strcmp(arg1, "start") == 0) {
+      out.printf("recording up to %u KB\n", (unsigned)m_config.traceSizeKb);
+      return CONSOLE_TRACE_START;
+    }
+    if (strcmp(arg1, "stop") == 0) {
+      return CONSOLE_TRACE_STOP;
+    }
+    if (strcmp(arg1, "dump") == 0) {
+      return CONSOLE_TRACE_DUMP;
+    }
+  }
+
+  out.println("commands: get [field] | set <field> <value> | defaults | save | allow [add|remove <mac>] | "
+              "filter [add|remove <company|uuid|appearance> <value> | clear] | calibrate | stats [reset] | trace start|stop|dump");
+  return CONSOLE_NONE;
+}
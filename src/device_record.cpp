@@ -0,0 +1,32 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Compact record of a scanned BLE device
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "device_record.h"
+#include "advert_fingerprint.h"
+#include "hot_path.h"
+
+void SCANNER_HOT deviceRecordFill(DeviceRecord& record, const ScanResult& result, MacKey address, bool known, uint32_t nowMs) {
+  record.address = address;
+  record.timeMs = nowMs;
+  record.rssi = result.rssi;
+  record.known = known;
+  record.addressType = result.addressType;
+
+  AdvertInfo advert;
+  advertParse(result.payload, result.payloadLength, &advert);
+  record.fingerprint = result.scanResponse ? 0 : advert.fingerprint;
+  if (advert.txPower != TX_POWER_UNKNOWN) {
+    record.txPower = advert.txPower;
+    record.txSource = TX_SOURCE_ADVERTISED;
+  } else {
+    record.txPower = advertClassTxPower(advert.appearance);
+    record.txSource = (record.txPower != TX_POWER_UNKNOWN) ? TX_SOURCE_CLASS : TX_SOURCE_NONE;
+  }
+}
@@ -10,229 +10,785 @@
 */
 
 #include <Arduino.h>
+#include <driver/gpio.h>
+#include <esp_task_wdt.h>
+
+// Serial log levels (SCANNER_LOG_LEVEL build flag)
+#include "log.h"
+#include "hot_path.h"
 
 // I2c Header
 #include <Wire.h>
 
 // BLE Headers
-#include <BLEDevice.h>
-#include <BLEUtils.h>
-#include <BLEScan.h>
-#include <BLEAdvertisedDevice.h>
+#include "scanner.h"
+#include "scan_scheduler.h"
+#include "scan_watchdog.h"
+#include "advert_rate_limiter.h"
+
+// Runtime configuration (NVS, serial console)
+#include "scanner_config.h"
+#include "config_store.h"
+#include "console.h"
+
+// Known device allowlist
+#include "allowlist.h"
+#include "allowlist_store.h"
+#include "advert_filter.h"
+#include "filter_store.h"
+#include "stationary_learner.h"
+#include "device_record.h"
+#include "ring_buffer.h"
+#include "triple_buffer.h"
+#include "audience_estimator.h"
+#include "mesh_table.h"
+#include "mesh_summary.h"
+#include "mesh_link.h"
+
+// LED Notification
+#include "led_notifier.h"
+
+// I2C response snapshot
+#include "status_frame.h"
+#include "i2c_registers.h"
+#include "telemetry.h"
+#include "power_manager.h"
+#include "trace_recorder.h"
 
 // Store known BLE devices (e.g. My phone, BLE earbuds, etc)
 // Remove all the addreses when the device is initially installed in the exhibition place
-String knownBLEAddresses[] = { "aa:bc:cc:dd:ee:ee", "54:2c:7b:87:71:a2", "72:09:b9:28:37:6c", 
+// These are only the defaults, an allowlist stored in NVS takes precedence
+// => "set calibrateOnBoot 1" + "save" (or "calibrate") learns the stationary devices of the empty venue instead
+const char* knownBLEAddresses[] = { "aa:bc:cc:dd:ee:ee", "54:2c:7b:87:71:a2", "72:09:b9:28:37:6c", 
                                "6c:9a:00:3a:65:47", "66:f4:d1:6c:fc:b2", "5a:2b:f4:61:71:aa", 
                                "f2:dc:7e:bd:f1:ab", "49:36:ef:f5:9f:0c", "4f:08:07:83:c3:62", 
                                "5b:51:f2:1d:66:4d", "53:11:d2:bf:fd:04", "74:be:f6:a4:81:2f", 
                                "d7:42:99:28:27:63" };
 
-int RSSI_THRESHOLD = -80;           // Normal Bluetooth detection radius
-int RSSI_THRESHOLD_FOOTSTEP = -50;  // Footstep Bluetooth detection radius
-
-int SCAN_INTERVAL = 25;             // Scanning interval time -> 25
-int SCAN_INTERVAL_WINDOW = 24;      // Scanning interval time(window) -> 24 // Less or equal to scan interval time
+Allowlist allowlist;                   // Known devices, edited by the aggregation task (console)
+TripleBuffer<Allowlist> knownDevices;  // Published copy, checked with the raw address of every scan result
+AdvertFilterRules filterRules;         // Device classes that are counted, edited by the aggregation task (console)
+TripleBuffer<AdvertFilter> advertFilter;  // Compiled rules, evaluated on the raw payload of every scan result
+StationaryLearner stationaryLearner;   // Calibration => learns the allowlist from an empty venue
+std::atomic<bool> calibrating(false);  // Known devices reach the aggregation task too while calibrating
+RingBuffer<DeviceRecord, 512> scanQueue;  // Classified adverts from the scan callback to the aggregation task
+AudienceEstimator audience;               // Presence table + audience mode of the unknown devices nearby
+MeshSummarizer meshSummarizer;            // Multi-scanner room => reports of the local devices
+MeshTable meshTable;                      // Head node => merged devices of all nodes, drives the audience mode
+uint32_t meshSentMs = 0;
+
+// Wake-up to detection latency => first advert of a device in range while the room is empty until the
+// audience state leaves 's'. The scan itself adds up to idleScanInterval before it catches the advert
+bool detectionPending = false;
+uint32_t detectionStartMs = 0;
+
+// All tunables (radius, audience modes, scan duty cycle, pins, ...) => see ScannerConfig for the defaults
+// Read once from NVS in setup(), afterwards only replaced by applyConfig() in the aggregation task
+ScannerConfig config;          // Running configuration
+ScannerConfig storedConfig;    // Edited by the console and I2C and saved as is, boot fields reach config after a restart
+Console console(storedConfig, allowlist, filterRules);  // Serial commands to change config and lists without a restart
 
 int RSSI_TH_COUNT = 0;              // Number of devices inside of the threshold radius
 int RSSI_TH_COUNT_FOOTSTEP = 0;     // Number of devices inside of the threshold radius (Close to the center)
 
-int scanTime = 5;   // Scanning duration time -> 5ms
-BLEScan* pBLEScan;  // BLE scan objects (Array)
+AdvertRateLimiter advertLimiter;           // Per-address advert rate limit in the scan callback
+ScanScheduler scanScheduler;               // Scan duty cycle from occupancy and advert rate
+TripleBuffer<ScanSettings> scanSettings;   // Settings chosen by the aggregation task, applied by the scan task
+ScanWatchdog scanWatchdog;                 // Stalled scan recovery, owned by the scan task
+std::atomic<uint32_t> scanResults(0);      // Scan callbacks so far, the watchdog's sign of life of the stack
+std::atomic<uint32_t> scanHoldStartMs(0);  // Audience state is held for scanHoldMs from then while a stalled scan recovers
+std::atomic<uint32_t> scanHoldMs(0);
+bool scanHeld = false;
+uint32_t reportStartMs = 0;
+
+//********** Tasks **********//
+// Scan task runs next to the BT controller, aggregation (counting, I2C message, LEDs) on the other core
+#ifdef CONFIG_BTDM_CONTROLLER_PINNED_TO_CORE
+const BaseType_t SCAN_CORE = CONFIG_BTDM_CONTROLLER_PINNED_TO_CORE;
+#else
+const BaseType_t SCAN_CORE = 0;
+#endif
+const BaseType_t AGGREGATION_CORE = 1 - SCAN_CORE;
+
+const int SCAN_TASK_PERIOD = 100;         // Scan supervision period (ms)
+const uint32_t SCAN_TASK_WDT_S = 30;      // Scan task blocked this long (s) => reboot, in place recovery is not possible
+const uint32_t SCAN_RECOVERY_GRACE = 2000;  // Hold after a recovery (ms), devices are heard again before they can expire
+const int AGGREGATION_TASK_PERIOD = 20;   // Queue drain period (ms)
+
+TaskHandle_t scanTaskHandle = NULL;
+TaskHandle_t aggregationTaskHandle = NULL;
 
 //********** Device detection flags **********//
 bool RSSI_TH_FLAG = false;
 bool RSSI_TH_FOOTSTEP_FLAG = false;
 
-bool DEVICE_PRESENCE = false;   // True -> More than 1 device in the area
-bool DEVICE_SMALL_NUM = false;  // True -> More than 5 addresses and less than 15 addresses in the area
-bool DEVICE_LARGE_NUM = false;  // True -> More than 16 addresses in the area
-
-bool known_device_found = false; // True -> Known devices are found
+bool DEVICE_PRESENCE = false;   // True -> At least 1 device in the area
+bool DEVICE_SMALL_NUM = false;  // True -> Small audience mode (audienceSmallEnter addresses and more)
+bool DEVICE_LARGE_NUM = false;  // True -> Large audience mode (audienceLargeEnter addresses and more)
 
 //********** I2C Command variable **********//
 char message = 's';
+StatusSnapshot status = { 's', 0, 0, 0, 0, 0, 0, 0 };    // Audience state behind the I2C status frame
+TripleBuffer<StatusSnapshot> i2cStatus;         // Published copy of status, the only thing requestEvent() reads
+TripleBuffer<ScannerConfig> i2cConfig;          // Published copies behind the other registers (i2c_registers.h)
+TripleBuffer<TelemetryFrame> i2cTelemetry;
+std::atomic<uint16_t> i2cKnownDevices(0);
+I2cRegisters i2cRegisters(storedConfig, allowlist, filterRules);   // Register selection and queued writes of the master
+uint32_t telemetryPublishedMs = 0;
+uint32_t telemetryReportMs = 0;
+std::atomic<uint32_t> i2cRequestCount(0);       // Requests served, logged later by the aggregation task
+uint32_t i2cRequestsLogged = 0;
+
+//********** I2C data-ready line **********//
+StatusSnapshot notifiedStatus = { 's', 0, 0, 0, 0, 0, 0, 0 };  // State the last data-ready assertion was for
+portMUX_TYPE dataReadyMux = portMUX_INITIALIZER_UNLOCKED;
+uint32_t dataReadySequence = 0;   // Frame the master has to read to clear the line
+uint32_t lastReadSequence = 0;    // Frame the master read last
+
+//Call back function => it will be called for every received advert while the scan runs continuously.
+//It classifies the device once and hands a compact record to the aggregation task. => Nothing slow may run here
+class MyAdvertisedDeviceCallbacks : public ScanCallbacks {
+  
+  // Classify the scanned device once and write its record in place into the scan queue (no copies, no heap)
+  // Known (stationary) devices are dropped right here, they never cost a queue slot or a table entry
+  void SCANNER_HOT onResult(const ScanResult& result) {
+    TELEMETRY_RESET_POINT(TELEMETRY_SCAN_CALLBACK);
+    TELEMETRY_CYCLES_START(startCycles);
+    scanResults.fetch_add(1, std::memory_order_relaxed);
+    uint32_t now = millis();
+    traceRecorderAdd(result, now);  // Raw venue traffic, the replay applies the allowlist and the rate limit itself
+    MacKey address = macKeyFromBytes(result.address);
+    bool known = knownDevices.read().contains(address);
+    if (known && !calibrating.load(std::memory_order_relaxed)) {
+      return;
+    }
+    if (!advertFilter.read().matches(result.payload, result.payloadLength)) {
+      TELEMETRY_COUNT(advertsFiltered);
+      return;  // Not a device class that is counted (TV, beacon, ...)
+    }
+    if (!advertLimiter.allow(address, now)) {
+      return;  // Same address forwarded less than advertRateLimit ago
+    }
+    DeviceRecord* record = scanQueue.acquire();
+    if (record == nullptr) {
+      return;  // Queue full, counted in scanQueue.dropped()
+    }
+    deviceRecordFill(*record, result, address, known, now);
+    scanQueue.commit();
+    TELEMETRY_CYCLES_STOP(onResult, startCycles);  // Only adverts that reach the queue, the early exits are cheaper
+  }
+};
 
-//********** LED Pins **********//
-int LED_GREEN = 18; // Green LED Control Pin (Devices are within RSSI_THRESHOLD range)
-int LED_RED = 5;    // Red LED Control Pin (Devices are within RSSI_THRESHOLD_FOOTSTEP range)
+// Track a queued advert in the audience estimator, known devices are not part of the audience
+void countDevice(const DeviceRecord& record) {
+  if (stationaryLearner.running()) {
+    stationaryLearner.add(record);
+    return;
+  }
+  if (record.known == true) {
+    return;
+  }
+  bool isNew;
+  audience.add(record, &isNew);
+  if (!detectionPending && audience.level() == AUDIENCE_NONE && record.rssi > config.rssiThreshold) {
+    detectionPending = true;
+    detectionStartMs = record.timeMs;
+  }
+#if LOG_ENABLED(LOG_LEVEL_DEBUG)
+  if (isNew || LOG_ENABLED(LOG_LEVEL_VERBOSE)) {
+    char address[18];
+    macKeyToString(record.address, address);
+    LOG_DEBUG("  Device Found Address: %s RSSI: %d %s", address, record.rssi, isNew ? "(new)" : "");
+  }
+#endif
+}
 
-//Call back function => it will be called once every few second. 
-//It checks if any new devices are available or not. => Set a flag if there is a new one
-class MyAdvertisedDeviceCallbacks : public BLEAdvertisedDeviceCallbacks {
-  
-  // Print all addresses of the scanned BLE devices 
-  void printAllBLEDevices(BLEAdvertisedDevice _device, int _index) {
-      //Uncomment to Enable Debug Information
-      Serial.println("************* Start **************");
-      Serial.println(sizeof(knownBLEAddresses));
-      Serial.println(sizeof(knownBLEAddresses[0]));
-      Serial.println(sizeof(knownBLEAddresses)/sizeof(knownBLEAddresses[0]));
-      Serial.println(_device.getAddress().toString().c_str());
-      Serial.println(knownBLEAddresses[_index].c_str());
-      Serial.println("************* End **************");
+// Assert the data-ready line if the published state differs enough from the one last notified
+// Small count changes are held back until they add up to dataReadyCountStep (hysteresis)
+void notifyDataReady() {
+  if (config.dataReadyPin < 0 || status.sequence == notifiedStatus.sequence) {
+    return;
   }
-  
-  // Flag check if there are known BLE devices in the TH range
-  void onResult(BLEAdvertisedDevice advertisedDevice) {
-    for (int i = 0; i < (sizeof(knownBLEAddresses) / sizeof(knownBLEAddresses[0])); i++) {
-      printAllBLEDevices(advertisedDevice, i);
-      if (strcmp(advertisedDevice.getAddress().toString().c_str(), knownBLEAddresses[i].c_str()) == 0) {
-        known_device_found = true;
-        break;
+  if (status.mode == notifiedStatus.mode &&
+      abs((int)status.count - (int)notifiedStatus.count) < config.dataReadyCountStep &&
+      abs((int)status.countFootstep - (int)notifiedStatus.countFootstep) < config.dataReadyCountStep) {
+    return;
+  }
+  notifiedStatus = status;
+
+  // The frame is already published, so a master that read it in between leaves the line low
+  portENTER_CRITICAL(&dataReadyMux);
+  dataReadySequence = status.sequence;
+  if ((int32_t)(lastReadSequence - dataReadySequence) < 0) {
+    gpio_set_level((gpio_num_t)config.dataReadyPin, HIGH);
+  }
+  portEXIT_CRITICAL(&dataReadyMux);
+}
+
+// Publish the audience state for the I2C master, the sequence number only moves when something changed
+void publishStatus() {
+  if (status.mode != message || status.count != RSSI_TH_COUNT || status.countFootstep != RSSI_TH_COUNT_FOOTSTEP) {
+    status.mode = message;
+    status.count = (uint16_t)RSSI_TH_COUNT;
+    status.countFootstep = (uint16_t)RSSI_TH_COUNT_FOOTSTEP;
+    status.sequence++;
+  }
+  const OccupancyTrend& trend = audience.trend();
+  status.arrivalRate = trend.arrivalRate();
+  status.departureRate = trend.departureRate();
+  status.meanDwell = trend.meanDwell();
+  status.updatedMs = millis();
+  i2cStatus.write(status);
+  notifyDataReady();
+}
+
+// Push the detection radius, RSSI filter and the audience buckets into the estimator
+void configureAudience() {
+  audience.configure(config);
+  meshTable.configure(config.presenceTtl);
+  meshTable.setThresholds(config.rssiThreshold, config.rssiThresholdFootstep);
+  meshSummarizer.configure(config.meshRefresh, config.meshRssiStep);
+}
+
+// Scan duty cycle and advert load reduction from the configuration
+void configureScan() {
+  advertLimiter.setInterval(config.advertRateLimit);
+
+  ScanSchedulerConfig schedule;
+  schedule.present.active = config.activeScan;
+  schedule.present.interval = config.scanInterval;
+  schedule.present.window = config.scanWindow;
+  schedule.present.filterDuplicates = config.filterDuplicates;
+  schedule.present.duplicateReset = config.duplicateReset;
+  schedule.present.stallTimeout = config.scanStallTimeout;
+  schedule.present.stallHold = config.presenceTtl;
+  schedule.idle.active = false;
+  schedule.idle.interval = config.idleScanInterval;
+  schedule.idle.window = config.idleScanWindow;
+  schedule.idle.filterDuplicates = config.filterDuplicates;
+  schedule.idle.duplicateReset = config.duplicateReset;
+  schedule.idle.stallTimeout = config.scanStallTimeout;
+  schedule.idle.stallHold = config.presenceTtl;
+  schedule.idleAfterMs = config.idleAfter;
+  schedule.busyAdvertRate = config.busyAdvertRate;
+  schedule.quietAdvertRate = config.quietAdvertRate;
+  schedule.minWindowPercent = config.minWindowPercent;
+  scanScheduler.configure(schedule, millis());
+  scanSettings.write(scanScheduler.settings());
+}
+
+// Apply the (changed) stored configuration at runtime, boot fields (pins, I2C address, mesh role) keep their
+// running values until the next restart
+void applyConfig() {
+  i2cConfig.write(storedConfig);
+  ScannerConfig next = storedConfig;
+  configKeepBoot(next, config);
+  if (!configValid(next)) {
+    LOG_WARN("Config : change only valid together with its boot fields => takes effect after a restart");
+    return;
+  }
+  config = next;
+  configureAudience();
+  configureScan();
+}
+
+// New allowlist => scan callback and I2C register
+void publishAllowlist() {
+  knownDevices.write(allowlist);
+  i2cKnownDevices.store((uint16_t)allowlist.size(), std::memory_order_relaxed);
+}
+
+// New filter rules => compiled once here, the scan callback only looks up the table
+void publishFilter() {
+  advertFilter.back().compile(filterRules);
+  advertFilter.publish();
+}
+
+// Calibration => no counting for calibrationMinutes, the audience state drains to 's' as the entries age out
+void startCalibration(uint32_t nowMs) {
+  stationaryLearner.begin(nowMs, (uint32_t)config.calibrationMinutes * 60000);
+  calibrating.store(true, std::memory_order_relaxed);
+  LOG_INFO("Calibration : learning stationary devices for %u minutes", (unsigned)config.calibrationMinutes);
+}
+
+// Devices heard steadily during the calibration replace the allowlist, which is stored right away
+void finishCalibration() {
+  size_t learned = stationaryLearner.result(allowlist, config.calibrationPresence, config.calibrationRssiSpread);
+  stationaryLearner.stop();
+  publishAllowlist();
+  calibrating.store(false, std::memory_order_relaxed);
+  bool saved = allowlistSave(allowlist);
+  if (config.calibrateOnBoot) {
+    config.calibrateOnBoot = false;
+    storedConfig.calibrateOnBoot = false;
+    saved = configSave(storedConfig) && saved;
+    i2cConfig.write(storedConfig);
+  }
+  LOG_INFO("Calibration : %u stationary devices of %u heard (%u not tracked) %s", (unsigned)learned,
+           (unsigned)stationaryLearner.candidates(), (unsigned)stationaryLearner.overflow(),
+           saved ? "saved" : "NOT SAVED");
+}
+
+// Serial console and I2C register writes => new configuration or allowlist take effect immediately,
+// "save" makes them persistent
+void applyChanges(uint16_t changes) {
+  if (changes & CONSOLE_CONFIG) {
+    applyConfig();
+  }
+  if (changes & CONSOLE_ALLOWLIST) {
+    publishAllowlist();
+  }
+  if (changes & CONSOLE_FILTER) {
+    publishFilter();
+  }
+  if (changes & CONSOLE_CALIBRATE) {
+    startCalibration(millis());
+  }
+  if (changes & CONSOLE_STATS) {
+    telemetryPrint(Serial);
+  }
+  if (changes & CONSOLE_STATS_RESET) {
+    telemetryRequestReset();   // Each task clears its own statistics
+  }
+  if (changes & CONSOLE_TRACE_START) {
+    traceRecorderStart((uint32_t)config.traceSizeKb * 1024, config.tracePayload);
+  }
+  if (changes & CONSOLE_TRACE_STOP) {
+    traceRecorderStop();
+  }
+  if (changes & CONSOLE_TRACE_DUMP) {
+    if (traceRecorderRunning()) {
+      LOG_INFO("Trace : stop the recording before the dump");
+    } else {
+      traceRecorderDump();
+    }
+  }
+}
+
+void pollCommands() {
+  applyChanges(console.poll(Serial));
+  applyChanges(i2cRegisters.poll());
+}
+
+// Node id of the mesh messages => the configured one, by default the last MAC byte (differs between the
+// boards of a room, a clash is fixed by setting meshNodeId)
+uint8_t meshNodeId() {
+  return (config.meshNodeId != 0) ? config.meshNodeId : (uint8_t)(ESP.getEfuseMac() >> 40);
+}
+
+// Multi-scanner room => a node broadcasts its changed devices every meshInterval, the head merges the
+// messages of all nodes and its own reports into meshTable
+void exchangeMesh(uint32_t nowMs) {
+  if (config.meshRole == MESH_OFF) {
+    return;
+  }
+  if (config.meshRole == MESH_HEAD) {
+    MeshPacket packet;
+    while (meshLinkReceive(packet)) {
+      meshTable.apply(packet.data, packet.length, nowMs);
+    }
+  }
+  if (nowMs - meshSentMs >= config.meshInterval) {
+    meshSentMs = nowMs;
+    uint8_t message[MESH_MESSAGE_MAX];
+    size_t length;
+    while ((length = meshSummarizer.build(audience.presence(), meshNodeId(), nowMs, message)) > 0) {
+      if (config.meshRole == MESH_HEAD) {
+        meshTable.apply(message, length, nowMs);
       } else {
-        known_device_found = false;
+        meshLinkSend(message, length);
       }
     }
-    Serial.printf("Advertised Device: %s", advertisedDevice.toString().c_str());
-    Serial.printf(" Known Device Found Flag: %s \n", (String)known_device_found);
   }
-};
+  meshTable.expire(nowMs);
+}
+
+// Audience state from the estimator (see AudienceEstimator::update)
+void updateAudienceState(uint32_t nowMs) {
+  bool changed = audience.update(nowMs);
+  RSSI_TH_COUNT = audience.count();
+  RSSI_TH_COUNT_FOOTSTEP = audience.countFootstep();
+  RSSI_TH_FLAG = RSSI_TH_COUNT > 0;
+  RSSI_TH_FOOTSTEP_FLAG = RSSI_TH_COUNT_FOOTSTEP > 0;
+
+  if (changed) {
+    LOG_DEBUG("Audience mode %c (%d devices in range)", audience.message(), RSSI_TH_COUNT);
+  }
+  if (detectionPending && (changed || nowMs - detectionStartMs > config.presenceTtl)) {
+    if (changed) {
+      TELEMETRY_ADD(detection, nowMs - detectionStartMs);
+    }
+    detectionPending = false;   // Counted, or the device never got into range
+  }
+  AudienceLevel level = audience.level();
+  DEVICE_PRESENCE = level != AUDIENCE_NONE;
+  DEVICE_SMALL_NUM = level == AUDIENCE_SMALL;
+  DEVICE_LARGE_NUM = level == AUDIENCE_LARGE;
+
+  // ***** SET THE COMMAND MESSAGE TO I2C COMM ***** //
+  // 's' == Stop (no audience), 'f' == Footstep (small audience), 'r' == Random vibration (few or large audience)
+  message = audience.message();
+  publishStatus();
+}
+
+// Print the current audience state
+void printAudienceSummary() {
+  // ***** Function to display the number of devices in the range of threshold ***** //
+  LOG_INFO("Number of BLE Devices (Green LED): %d  Number of BLE Devices in close (Red LED): %d",
+           RSSI_TH_COUNT, RSSI_TH_COUNT_FOOTSTEP);
+
+  // ***** Function to display whether the number of scanned machines is in a small or large range ***** //
+  if (DEVICE_PRESENCE == true) {
+    LOG_INFO("POTENTIOAL AUDIENCE : %d%s", RSSI_TH_COUNT,
+             DEVICE_SMALL_NUM ? " SMALL NUMBER !! " : (DEVICE_LARGE_NUM ? " LARGE NUMBER !! " : ""));
+  } else {
+    LOG_INFO("NO AUDIENCE!! ");
+  }
+
+  // ***** Function to display the device presence check flag in the each range  ***** //
+  LOG_INFO("DEVICES IN RANGE : %s  /  DEVICES IN CLOSE RANGE : %s",
+           RSSI_TH_FLAG ? "TRUE" : "FALSE", RSSI_TH_FOOTSTEP_FLAG ? "TRUE" : "FALSE");
+
+  // ***** Occupancy trend (as sent to the Teensy) ***** //
+  const OccupancyTrend& trend = audience.trend();
+  LOG_INFO("ARRIVALS : %u.%u / min  DEPARTURES : %u.%u / min  MEAN DWELL : %u s", trend.arrivalRate() / 10,
+           trend.arrivalRate() % 10, trend.departureRate() / 10, trend.departureRate() % 10, trend.meanDwell());
+
+  // ***** Bounded scan memory: tracked devices and what had to be dropped ***** //
+  LOG_DEBUG("Tracked devices: %u / %u  Evicted: %u  Queue drops: %u  Rate limited: %u  Address rotations: %u",
+            (unsigned)audience.presence().size(), (unsigned)PresenceTable::CAPACITY,
+            (unsigned)audience.presence().evictions(), (unsigned)scanQueue.dropped(),
+            (unsigned)advertLimiter.suppressed(), (unsigned)audience.presence().takeovers());
+  if (config.meshRole == MESH_HEAD) {
+    LOG_DEBUG("Room devices: %u / %u  Evicted: %u  Messages: %u  Dropped: %u", (unsigned)meshTable.size(),
+              (unsigned)MeshTable::CAPACITY, (unsigned)meshTable.evictions(), (unsigned)meshTable.messages(),
+              (unsigned)meshLinkDropped());
+  } else if (config.meshRole == MESH_NODE) {
+    LOG_DEBUG("Reports sent: %u", (unsigned)meshSummarizer.reports());
+  }
+  LOG_INFO("");
+}
 
 // LED Notification
+// One green blink per device in range, then one red blink per device in close range (returns immediately)
 void ledNotification() {
-  // LED Blinks
-  for (int i = 0; i < RSSI_TH_COUNT; i++) {
-    digitalWrite(LED_GREEN, HIGH);
-    delay(15);
-    digitalWrite(LED_GREEN, LOW);
-    delay(15);
-  }
-  for (int i = 0; i < RSSI_TH_COUNT_FOOTSTEP; i++) {
-    digitalWrite(LED_RED, HIGH);
-    delay(15);
-    digitalWrite(LED_RED, LOW);
-    delay(15);
-  }
+  TELEMETRY_US_START(startUs);
+  ledNotifierShow(RSSI_TH_COUNT, RSSI_TH_COUNT_FOOTSTEP);
+  TELEMETRY_US_STOP(ledNotification, startUs);
 };
 
 //I2C communication
-void requestEvent() {
-  Wire.write(message);  // respond with message of 6 bytes
-  // as expected by master
-  Serial.println("Send MODE 2 signal" + message);
+// Status frame, the mode byte comes first as expected by the master
+void SCANNER_HOT serveStatus() {
+  const StatusSnapshot& snapshot = i2cStatus.read();
+  uint8_t frame[STATUS_FRAME_SIZE];
+  size_t length = encodeStatusFrame(snapshot, millis(), frame);
+  Wire.write(frame, length);
+
+  // The master has the notified state now => clear the data-ready line
+  if (config.dataReadyPin >= 0) {
+    portENTER_CRITICAL(&dataReadyMux);
+    lastReadSequence = snapshot.sequence;
+    if ((int32_t)(lastReadSequence - dataReadySequence) >= 0) {
+      gpio_set_level((gpio_num_t)config.dataReadyPin, LOW);
+    }
+    portEXIT_CRITICAL(&dataReadyMux);
+  }
 }
 
-void setup() {
-  // put your setup code here, to run once:
-  Serial.begin(115200);
-  Wire.begin(8);
-  Wire.onRequest(requestEvent);  // register event
+// Runs in the Wire slave callback context => only serve the published snapshots, no I/O or locks here
+void SCANNER_HOT requestEvent() {
+  TELEMETRY_RESET_POINT(TELEMETRY_I2C);
+  TELEMETRY_CYCLES_START(startCycles);
+  uint8_t selected = i2cRegisters.selected();
+  if (selected == REG_TELEMETRY) {
+    Wire.write(i2cTelemetry.read().data, TELEMETRY_FRAME_SIZE);
+  } else if (selected == REG_CONFIG || selected == REG_ALLOWLIST) {
+    uint8_t frame[I2C_CONFIG_FRAME_SIZE];
+    size_t length = (selected == REG_CONFIG) ? i2cRegisters.encodeConfig(i2cConfig.read(), frame)
+                                             : i2cRegisters.encodeAllowlist(i2cKnownDevices.load(), frame);
+    Wire.write(frame, length);
+  } else {
+    serveStatus();
+  }
+  i2cRegisters.served();
+  i2cRequestCount.fetch_add(1, std::memory_order_relaxed);
+  TELEMETRY_CYCLES_STOP(requestEvent, startCycles);
+}
 
-  // LED Indicators
-  pinMode(LED_GREEN, OUTPUT);
-  pinMode(LED_RED, OUTPUT);
+// Register selection or write of the master, the writes are applied by the aggregation task
+void SCANNER_HOT receiveEvent(int) {
+  uint8_t data[I2cRegisters::WRITE_MAX + 1];
+  size_t length = 0;
+  while (Wire.available() > 0) {
+    int c = Wire.read();
+    if (length < sizeof(data)) {
+      data[length] = (uint8_t)c;
+    }
+    length++;   // Longer than any write => rejected by receive()
+  }
+  i2cRegisters.receive(data, (length < sizeof(data)) ? length : sizeof(data));
+}
 
-  // ***** BLE Scanner initialize ***** //
-  Serial.println("BLE Scanning...");  // Print Scanning
-  BLEDevice::init("");
-  pBLEScan = BLEDevice::getScan();                                            // Create new scan
-  pBLEScan->setAdvertisedDeviceCallbacks(new MyAdvertisedDeviceCallbacks());  // Init Callback Function
-  pBLEScan->setActiveScan(true);                                              // Active scan uses more power, but get results faster
-  pBLEScan->setInterval(SCAN_INTERVAL);                                       // Set Scan interval
-  pBLEScan->setWindow(SCAN_INTERVAL_WINDOW);                                  // Less or equal setInterval value
+
+// Deferred I2C log, printed from the aggregation task
+void printI2CRequests() {
+  uint32_t requests = i2cRequestCount.load(std::memory_order_relaxed);
+  if (requests != i2cRequestsLogged) {
+    LOG_DEBUG("Sent MODE signal %c to %u requests", message, (unsigned)(requests - i2cRequestsLogged));
+    i2cRequestsLogged = requests;
+  }
 }
 
-void loop() {
-  // put your main code here, to run repeatedly:
-  BLEScanResults foundDevices = pBLEScan->start(scanTime, false);
-  std::vector<std::string> stationaryBLEAddresses;
-
-  // ***** Device counting function ***** //
-  for (int i = 0; i < foundDevices.getCount(); i++) {
-    BLEAdvertisedDevice device = foundDevices.getDevice(i);
-    int rssi = device.getRSSI();
-    //Serial.print("RSSI: ");
-    //Serial.print(rssi);
-    
-    // Normal RSSI radius from the center
-    if (rssi > RSSI_THRESHOLD && known_device_found == false) {
-
-      RSSI_TH_COUNT++;
-      RSSI_TH_FLAG = true;
-
-      // Small RSSI radius from the center
-      if (rssi > RSSI_THRESHOLD_FOOTSTEP) {
-        RSSI_TH_COUNT_FOOTSTEP++;
-        RSSI_TH_FOOTSTEP_FLAG = true;
-      }
+// Stop the running scan, its duration goes to the scan session telemetry
+void stopScan(uint32_t startedMs) {
+  if (scannerRunning()) {
+    TELEMETRY_ADD(scanSession, millis() - startedMs);
+  }
+  scannerStop();
+}
+
+// Watchdog step for a stalled scan (see scan_watchdog.h). The published audience state is held meanwhile,
+// a scan that delivers nothing is not an empty room
+void superviseScan(const ScanSettings& applied, uint32_t* startedMs) {
+  uint32_t now = millis();
+  if (scanWatchdog.stallTimeout() != applied.stallTimeout) {
+    scanWatchdog.configure(applied.stallTimeout, now);
+  }
+  bool wasRecovering = scanWatchdog.recovering();
+  switch (scanWatchdog.update(now, scanResults.load(std::memory_order_relaxed), scannerRunning())) {
+    case WATCHDOG_RESTART_SCAN:
+      TELEMETRY_COUNT(scanRestarts);
+      stopScan(*startedMs);
+      scannerRestart(applied);
+      *startedMs = now;
+      break;
+    case WATCHDOG_REINIT_STACK:
+      TELEMETRY_COUNT(stackReinits);
+      stopScan(*startedMs);
+      scannerReset();   // Scan starts again in scanTask
+      break;
+    default:
+      break;
+  }
+  uint32_t recoveryMs;
+  if (!wasRecovering && scanWatchdog.recovering()) {
+    scanHoldStartMs.store(now, std::memory_order_relaxed);
+    scanHoldMs.store(applied.stallHold, std::memory_order_release);
+  } else if (scanWatchdog.recovered(&recoveryMs)) {
+    TELEMETRY_ADD(scanRecovery, recoveryMs);
+    scanHoldStartMs.store(now, std::memory_order_relaxed);
+    scanHoldMs.store(SCAN_RECOVERY_GRACE, std::memory_order_release);
+  }
+}
+
+// Scan task => keeps the continuous scan running, adverts arrive through the scan callback
+void scanTask(void*) {
+  ScanSettings applied = scanSettings.read();
+  uint32_t startedMs = 0;
+  esp_task_wdt_add(NULL);
+  for (;;) {
+    esp_task_wdt_reset();
+    TELEMETRY_RESET_POINT(TELEMETRY_SCAN_TASK);
+    superviseScan(applied, &startedMs);
+
+    // New duty cycle from the scheduler => stop, the scan restarts below once the stack reports it stopped.
+    // The config is only read by the aggregation task, supervision values arrive here with the settings
+    const ScanSettings& wanted = scanSettings.read();
+    if (wanted.active != applied.active || wanted.interval != applied.interval || wanted.window != applied.window ||
+        wanted.filterDuplicates != applied.filterDuplicates) {
+      stopScan(startedMs);
+    }
+    applied = wanted;
+    // The controller duplicate filter reports an address once per scan => restart to get fresh RSSI
+    if (applied.filterDuplicates && scannerRunning() && millis() - startedMs >= applied.duplicateReset) {
+      stopScan(startedMs);
+      startedMs = millis();
     }
-    stationaryBLEAddresses.push_back(device.getAddress().toString().c_str());
-    Serial.printf("  Device Found Address: %s \n", stationaryBLEAddresses[i].c_str());
+    if (scannerRunning() == false) {
+      scannerStart(applied);
+      startedMs = millis();
+      TELEMETRY_SET(scanInterval, applied.interval);
+      TELEMETRY_SET(scanWindow, applied.window);
+    }
+    vTaskDelay(pdMS_TO_TICKS(SCAN_TASK_PERIOD));
   }
+}
 
-  // ***** Function to display the number of devices in the range of threshold ***** //
-  Serial.print("Number of BLE Devices (Green LED): ");
-  Serial.print(RSSI_TH_COUNT);
-  Serial.print("  Number of BLE Devices in close (Red LED): ");
-  Serial.println(RSSI_TH_COUNT_FOOTSTEP);
+// Aggregation task => drains the scan queue, updates the audience state and starts the LED pattern
+void aggregationTask(void*) {
+  TickType_t wakeTime = xTaskGetTickCount();
+  uint32_t scanResultsSeen = scanResults.load(std::memory_order_relaxed);
+  for (;;) {
+    TELEMETRY_RESET_POINT(TELEMETRY_AGGREGATION);
+    TELEMETRY_US_START(startUs);
+
+    // ***** Device counting function ***** //
+    DeviceRecord record;
+    while (scanQueue.pop(record)) {
+      countDevice(record);
+    }
+    // The scheduler needs the air traffic the window sees: every scan callback, before the allowlist,
+    // the filter and the rate limiter (those cap a device at a few records per second whatever the window)
+    uint32_t results = scanResults.load(std::memory_order_relaxed);
+    uint32_t adverts = results - scanResultsSeen;
+    scanResultsSeen = results;
+    uint32_t now = millis();
+    if (stationaryLearner.finished(now)) {
+      finishCalibration();
+    }
+    exchangeMesh(now);
+    uint32_t holdMs = scanHoldMs.load(std::memory_order_acquire);
+    bool held = now - scanHoldStartMs.load(std::memory_order_relaxed) < holdMs;
+    if (held != scanHeld) {
+      scanHeld = held;
+      LOG_WARN("Scan %s", held ? "stalled => recovering, audience state held" : "running again");
+    }
+    if (!held) {
+      updateAudienceState(now);   // Otherwise the last published state stays, nothing expires during the outage
+    }
 
-  // ***** Function to display whether the number of scanned machines is in a small or large range ***** //
-  if (RSSI_TH_COUNT > 0) {
-    DEVICE_PRESENCE = true;
-    Serial.print("POTENTIOAL AUDIENCE : ");
-    if (RSSI_TH_COUNT >= 5 && RSSI_TH_COUNT <= 15) {
-      DEVICE_SMALL_NUM = true;
-      DEVICE_LARGE_NUM = false;
-      Serial.print(RSSI_TH_COUNT);
-      Serial.println(" SMALL NUMBER !! ");
-    } else if (RSSI_TH_COUNT > 15) {
-      DEVICE_LARGE_NUM = true;
-      DEVICE_SMALL_NUM = false;
-      Serial.print(RSSI_TH_COUNT);
-      Serial.println(" LARGE NUMBER !! ");
+    // ***** Scan duty cycle ***** //
+    // A calibration run counts as presence => full duty cycle and clock while the stationary devices are learned
+    bool active = DEVICE_PRESENCE || calibrating.load(std::memory_order_relaxed);
+    if (scanScheduler.update(now, active, adverts)) {
+      const ScanSettings& settings = scanScheduler.settings();
+      scanSettings.write(settings);
+      LOG_DEBUG("Scan %s: %s, interval %u ms, window %u ms (%u adverts/s)",
+                scanScheduler.idle() ? "idle" : "present", settings.active ? "active" : "passive",
+                settings.interval, settings.window, scanScheduler.advertRate());
     }
-  } else {
-    DEVICE_PRESENCE = false;
-    DEVICE_SMALL_NUM = false;
-    DEVICE_LARGE_NUM = false;
-    Serial.println("NO AUDIENCE!! ");
+    powerSetActive(active || !scanScheduler.idle());   // Low power only while the scheduler is idle
+    TELEMETRY_SET(advertRate, scanScheduler.advertRate());
+    TELEMETRY_US_STOP(aggregation, startUs);
+
+    // ***** Report the audience state ***** //
+    if (now - reportStartMs >= (uint32_t)config.reportInterval * 1000) {
+      reportStartMs = now;
+      printAudienceSummary();
+      printI2CRequests();
+
+      // ***** Turn on LEDs depends on the number of devices in the each range ***** //
+      ledNotification();
+    }
+#if SCANNER_TELEMETRY && SCANNER_TELEMETRY_REPORT
+    // Bench builds => latency report on the serial port without a console
+    if (now - telemetryReportMs >= (uint32_t)SCANNER_TELEMETRY_REPORT * 1000) {
+      telemetryReportMs = now;
+      telemetryPrint(Serial);
+    }
+#endif
+
+    pollCommands();
+
+    // ***** Telemetry register ***** //
+    if (now - telemetryPublishedMs >= 1000) {
+      telemetryPublishedMs = now;
+      TelemetryFrame frame;
+      telemetryEncode(frame);
+      i2cTelemetry.write(frame);
+    }
+
+    vTaskDelayUntil(&wakeTime, pdMS_TO_TICKS(AGGREGATION_TASK_PERIOD));
   }
+}
 
-  // ***** Function to display the device presence check flag in the each range  ***** //
-  Serial.print("DEVICES IN RANGE : ");
-  if (RSSI_TH_FLAG == 1) {
-    Serial.print("TRUE  /");
-  } else {
-    Serial.print("FALSE  /");
+void setup() {
+  // put your setup code here, to run once:
+  Serial.begin(115200);
+
+  // ***** Configuration ***** //
+  // One NVS blob, no parsing => defaults if nothing valid is stored
+  configDefaults(config);
+  bool stored = configLoad(config);
+  storedConfig = config;
+
+  if (config.dataReadyPin >= 0) {
+    pinMode(config.dataReadyPin, OUTPUT);
+    digitalWrite(config.dataReadyPin, LOW);
   }
-  Serial.print("  DEVICES IN CLOSE RANGE : ");
-  if (RSSI_TH_FOOTSTEP_FLAG == 1) {
-    Serial.println("TRUE");
-  } else {
-    Serial.println("FALSE");
+  publishStatus();               // Valid snapshots before the master can ask for them
+  i2cConfig.write(storedConfig);
+  TelemetryFrame telemetryFrame;
+  telemetryEncode(telemetryFrame);
+  i2cTelemetry.write(telemetryFrame);
+  if (config.meshRole != MESH_NODE) {
+    // Only the head of a multi-scanner room serves the Teensy
+    Wire.begin(config.i2cAddress);
+    Wire.onRequest(requestEvent);  // register event
+    Wire.onReceive(receiveEvent);
   }
-  Serial.println();
-  Serial.println();
 
-  // ***** Turn on LEDs depends on the number of devices in the each range ***** //
-  ledNotification();
+  // LED Indicators
+  ledNotifierBegin(config.ledGreen, config.ledRed, config.ledBlinkTime);
+
+  // ***** Known device allowlist ***** //
+  // Parse the MAC addresses once, the scan callback only compares 48-bit keys
+  if (!allowlistLoad(allowlist)) {
+    for (size_t i = 0; i < sizeof(knownBLEAddresses) / sizeof(knownBLEAddresses[0]); i++) {
+      MacKey key;
+      if (macKeyFromString(knownBLEAddresses[i], &key)) {
+        allowlist.add(key);
+      }
+    }
+  }
+  publishAllowlist();
+  LOG_INFO("Configuration : %s  Known devices : %u", stored ? "stored" : "defaults", (unsigned)allowlist.size());
+
+  // ***** Advert filter ***** //
+  // No stored rules => every advert is counted
+  filterRulesLoad(filterRules);
+  publishFilter();
+  LOG_INFO("Advert filter : %u rules", (unsigned)filterRules.size());
+  if (config.calibrateOnBoot) {
+    startCalibration(millis());
+  }
 
-  // ***** SET THE COMMAND MESSAGE TO I2C COMM ***** //
-  // Devices are detacted within the threshold radius
-  if (DEVICE_PRESENCE == true) {
-    if (DEVICE_SMALL_NUM == true) {
-      // Send an i2c message for mode 2 == Footstep
-      message = 'f';  // SMALL
-    } else {
-      // Send an i2c message for mode 1 == Random vibration
-      message = 'r';  // LARGE
+  // ***** Presence estimator ***** //
+  configureAudience();
+  // Scan results only live in these two static tables, peak memory does not depend on the crowd size
+  LOG_INFO("Scan memory : %u bytes (audience estimator) + %u bytes (scan queue)",
+           (unsigned)sizeof(audience), (unsigned)sizeof(scanQueue));
+
+  // ***** Power management ***** //
+  // The scheduler starts in the present state => full clock until the room has been empty for idleAfter
+  static const char* POWER_MODES[] = { "full clock", "frequency scaling", "frequency scaling + light sleep" };
+  uint8_t powerMode = powerBegin(config.powerMode, SDA);
+  LOG_INFO("Power : %s%s", POWER_MODES[powerMode],
+           (powerMode != config.powerMode) ? " (no esp_pm in this core, CPU clock set directly)" : "");
+
+  // ***** Multi-scanner room ***** //
+  if (config.meshRole != MESH_OFF) {
+    bool linked = meshLinkBegin(config.meshChannel, config.meshRole == MESH_HEAD);
+    if (config.meshRole == MESH_HEAD) {
+      audience.useMerged(&meshTable);
     }
-  } else {  
-    // No devices in the threshold radius
-    // Send an i2c message for mode 0 == Stop
-    message = 's';  // NO
+    LOG_INFO("Mesh : %s %u on channel %u%s", (config.meshRole == MESH_HEAD) ? "head" : "node",
+             (unsigned)meshNodeId(), (unsigned)config.meshChannel, linked ? "" : " => ESP-NOW start failed");
   }
 
-  // ***** Reset device counting variables ***** //
-  RSSI_TH_COUNT = 0;
-  RSSI_TH_COUNT_FOOTSTEP = 0;
-  RSSI_TH_FLAG = false;
-  RSSI_TH_FOOTSTEP_FLAG = false;
+  // ***** Scan scheduler and advert load reduction ***** //
+  configureScan();
 
-  // delete results fromBLEScan buffer to release memory
-  pBLEScan->clearResults();
+  // ***** BLE Scanner initialize ***** //
+  LOG_INFO("BLE Scanning...");  // Print Scanning
+  scannerBegin(new MyAdvertisedDeviceCallbacks());  // Init Callback Function, the scan task starts scanning
+
+  // ***** Trace recorder (idle until "trace start") ***** //
+  if (!traceRecorderBegin(AGGREGATION_CORE)) {
+    LOG_INFO("Trace : no LittleFS partition, recording not available");
+  }
 
-  // clear stationaryBLEAddresses
-  stationaryBLEAddresses.clear();
-}
\ No newline at end of file
+  // ***** Tasks ***** //
+  // The scan task resets the task watchdog every pass, a panic reboot is the last resort after the in place recovery
+  esp_task_wdt_init(SCAN_TASK_WDT_S, true);
+  xTaskCreatePinnedToCore(scanTask, "scan", 4096, NULL, 3, &scanTaskHandle, SCAN_CORE);
+  xTaskCreatePinnedToCore(aggregationTask, "aggregation", 4096, NULL, 2, &aggregationTaskHandle, AGGREGATION_CORE);
+  TELEMETRY_SET(scanTask, scanTaskHandle);
+  TELEMETRY_SET(aggregationTask, aggregationTaskHandle);
+}
+
+void loop() {
+  // Everything runs in scanTask and aggregationTask
+  vTaskDelete(NULL);
+};
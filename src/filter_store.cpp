@@ -0,0 +1,69 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Persistent storage of the advert filter rules in NVS
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#include "filter_store.h"
+
+static const char* NVS_NAMESPACE = "scanner";
+static const char* NVS_KEY_FILTER = "filter";
+static const uint8_t FILTER_BLOB_VERSION = 1;  // Blob layout: [version][kind][value:4]...
+static const size_t RULE_SIZE = 5;
+
+bool filterRulesLoad(AdvertFilterRules& rules) {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, true)) {
+    return false;
+  }
+
+  uint8_t blob[1 + AdvertFilterRules::CAPACITY * RULE_SIZE];
+  size_t length = prefs.getBytesLength(NVS_KEY_FILTER);
+  bool valid = length >= 1 && length <= sizeof(blob) && (length - 1) % RULE_SIZE == 0 &&
+               prefs.getBytes(NVS_KEY_FILTER, blob, length) == length &&
+               blob[0] == FILTER_BLOB_VERSION;
+  prefs.end();
+  if (!valid) {
+    return false;
+  }
+
+  rules.clear();
+  for (size_t i = 1; i < length; i += RULE_SIZE) {
+    FilterRule rule;
+    rule.kind = blob[i];
+    rule.value = (uint32_t)blob[i + 1] | ((uint32_t)blob[i + 2] << 8) | ((uint32_t)blob[i + 3] << 16) |
+                 ((uint32_t)blob[i + 4] << 24);
+    rules.add(rule);
+  }
+  return true;
+}
+
+bool filterRulesSave(const AdvertFilterRules& rules) {
+  uint8_t blob[1 + AdvertFilterRules::CAPACITY * RULE_SIZE];
+  blob[0] = FILTER_BLOB_VERSION;
+  for (size_t i = 0; i < rules.size(); i++) {
+    const FilterRule& rule = rules.at(i);
+    uint8_t* p = &blob[1 + i * RULE_SIZE];
+    p[0] = rule.kind;
+    p[1] = (uint8_t)rule.value;
+    p[2] = (uint8_t)(rule.value >> 8);
+    p[3] = (uint8_t)(rule.value >> 16);
+    p[4] = (uint8_t)(rule.value >> 24);
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, false)) {
+    return false;
+  }
+  size_t length = 1 + rules.size() * RULE_SIZE;
+  bool ok = prefs.putBytes(NVS_KEY_FILTER, blob, length) == length;
+  prefs.end();
+  return ok;
+}
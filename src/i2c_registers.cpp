@@ -0,0 +1,141 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Register-addressed I2C slave protocol
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <string.h>
+
+#include "i2c_registers.h"
+#include "hot_path.h"
+#include "console.h"
+#include "config_store.h"
+#include "allowlist_store.h"
+#include "filter_store.h"
+#include "status_frame.h"
+
+static const uint8_t ALLOWLIST_ADD = 1;
+static const uint8_t ALLOWLIST_REMOVE = 2;
+static const uint8_t ALLOWLIST_CLEAR = 3;
+
+static const uint8_t COMMAND_SAVE = 1;
+static const uint8_t COMMAND_DEFAULTS = 2;
+static const uint8_t COMMAND_CALIBRATE = 3;
+
+I2cRegisters::I2cRegisters(ScannerConfig& config, Allowlist& allowlist, const AdvertFilterRules& filterRules)
+    : m_config(config), m_allowlist(allowlist), m_filterRules(filterRules), m_register(REG_STATUS), m_field(0), m_result(I2C_RESULT_NONE) {}
+
+void SCANNER_HOT I2cRegisters::receive(const uint8_t* data, size_t length) {
+  if (length == 0) {
+    return;
+  }
+  m_register.store(data[0], std::memory_order_relaxed);
+  if (data[0] == REG_CONFIG && length >= 2) {
+    m_field.store(data[1], std::memory_order_relaxed);   // The config read shows the field that was written
+  }
+  if (length == 1 || (data[0] == REG_CONFIG && length == 2)) {
+    return;   // Selection only
+  }
+
+  if (length > WRITE_MAX) {
+    m_result.store(I2C_RESULT_INVALID, std::memory_order_relaxed);
+    return;
+  }
+  Write* write = m_writes.acquire();
+  if (write == nullptr) {
+    m_result.store(I2C_RESULT_FAILED, std::memory_order_relaxed);
+    return;   // Queue full, counted in dropped()
+  }
+  write->length = (uint8_t)length;
+  memcpy(write->data, data, length);
+  m_writes.commit();
+  m_result.store(I2C_RESULT_PENDING, std::memory_order_relaxed);
+}
+
+size_t SCANNER_HOT I2cRegisters::encodeConfig(const ScannerConfig& snapshot, uint8_t* frame) const {
+  uint8_t field = m_field.load(std::memory_order_relaxed);
+  uint32_t value = (uint32_t)configFieldGet(snapshot, field);
+  frame[0] = field;
+  frame[1] = (uint8_t)value;
+  frame[2] = (uint8_t)(value >> 8);
+  frame[3] = (uint8_t)(value >> 16);
+  frame[4] = (uint8_t)(value >> 24);
+  frame[5] = m_result.load(std::memory_order_relaxed);
+  frame[6] = crc8(frame, I2C_CONFIG_FRAME_SIZE - 1);
+  return I2C_CONFIG_FRAME_SIZE;
+}
+
+size_t SCANNER_HOT I2cRegisters::encodeAllowlist(uint16_t knownDevices, uint8_t* frame) const {
+  frame[0] = (uint8_t)knownDevices;
+  frame[1] = (uint8_t)(knownDevices >> 8);
+  frame[2] = (uint8_t)Allowlist::CAPACITY;
+  frame[3] = (uint8_t)(Allowlist::CAPACITY >> 8);
+  frame[4] = m_result.load(std::memory_order_relaxed);
+  frame[5] = crc8(frame, I2C_ALLOWLIST_FRAME_SIZE - 1);
+  return I2C_ALLOWLIST_FRAME_SIZE;
+}
+
+uint16_t I2cRegisters::poll() {
+  uint16_t changes = CONSOLE_NONE;
+  Write write;
+  while (m_writes.pop(write)) {
+    changes |= execute(write);
+  }
+  return changes;
+}
+
+uint16_t I2cRegisters::execute(const Write& write) {
+  uint8_t result = I2C_RESULT_INVALID;
+  uint16_t changes = CONSOLE_NONE;
+
+  switch (write.data[0]) {
+    // ***** Configuration (same checks as the console "set") ***** //
+    case REG_CONFIG:
+      if (write.length == 6) {
+        int32_t value = (int32_t)((uint32_t)write.data[2] | ((uint32_t)write.data[3] << 8) |
+                                  ((uint32_t)write.data[4] << 16) | ((uint32_t)write.data[5] << 24));
+        ScannerConfig changed = m_config;
+        if (configFieldSet(changed, write.data[1], value) && configValid(changed)) {
+          m_config = changed;
+          result = I2C_RESULT_OK;
+          changes = CONSOLE_CONFIG;
+        }
+      }
+      break;
+
+    // ***** Known device allowlist ***** //
+    case REG_ALLOWLIST:
+      if (write.length == 2 && write.data[1] == ALLOWLIST_CLEAR) {
+        m_allowlist.clear();
+        result = I2C_RESULT_OK;
+        changes = CONSOLE_ALLOWLIST;
+      } else if (write.length == 8 && (write.data[1] == ALLOWLIST_ADD || write.data[1] == ALLOWLIST_REMOVE)) {
+        MacKey key = macKeyFromBytes(&write.data[2]);
+        bool ok = (write.data[1] == ALLOWLIST_ADD) ? m_allowlist.add(key) : m_allowlist.remove(key);
+        result = ok ? I2C_RESULT_OK : I2C_RESULT_FAILED;
+        changes = ok ? CONSOLE_ALLOWLIST : CONSOLE_NONE;
+      }
+      break;
+
+    // ***** Commands ***** //
+    case REG_COMMAND:
+      if (write.length == 2 && write.data[1] == COMMAND_SAVE) {
+        result = (configSave(m_config) && allowlistSave(m_allowlist) && filterRulesSave(m_filterRules)) ?
+                 I2C_RESULT_OK : I2C_RESULT_FAILED;
+      } else if (write.length == 2 && write.data[1] == COMMAND_DEFAULTS) {
+        configDefaults(m_config);
+        result = I2C_RESULT_OK;
+        changes = CONSOLE_CONFIG;
+      } else if (write.length == 2 && write.data[1] == COMMAND_CALIBRATE) {
+        result = I2C_RESULT_OK;
+        changes = CONSOLE_CALIBRATE;
+      }
+      break;
+  }
+  m_result.store(result, std::memory_order_relaxed);
+  return changes;
+}
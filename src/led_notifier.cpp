@@ -0,0 +1,90 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Non-blocking LED notification (esp_timer driven)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+
+#include "led_notifier.h"
+
+static esp_timer_handle_t ledTimer = NULL;
+static portMUX_TYPE ledMux = portMUX_INITIALIZER_UNLOCKED;
+
+static gpio_num_t greenLed;
+static gpio_num_t redLed;
+static uint32_t blinkPeriodUs;
+
+// Pattern being rendered: every blink is one "on" step followed by one "off" step
+static int greenCount = 0;
+static int redCount = 0;
+static int stepIndex = 0;
+static int stepCount = 0;
+
+static void ledTimerCallback(void*) {
+  portENTER_CRITICAL(&ledMux);
+  if (stepIndex >= stepCount) {
+    portEXIT_CRITICAL(&ledMux);
+    gpio_set_level(greenLed, LOW);
+    gpio_set_level(redLed, LOW);
+    esp_timer_stop(ledTimer);
+    return;
+  }
+  int blink = stepIndex / 2;
+  bool on = (stepIndex % 2) == 0;
+  gpio_num_t led = (blink < greenCount) ? greenLed : redLed;
+  stepIndex++;
+  portEXIT_CRITICAL(&ledMux);
+
+  gpio_set_level(led, on ? HIGH : LOW);
+}
+
+void ledNotifierBegin(int greenPin, int redPin, uint32_t blinkMs) {
+  greenLed = (gpio_num_t)greenPin;
+  redLed = (gpio_num_t)redPin;
+  blinkPeriodUs = blinkMs * 1000;
+
+  pinMode(greenPin, OUTPUT);
+  pinMode(redPin, OUTPUT);
+  digitalWrite(greenPin, LOW);
+  digitalWrite(redPin, LOW);
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = ledTimerCallback;
+  timerArgs.dispatch_method = ESP_TIMER_TASK;
+  timerArgs.name = "led";
+  esp_timer_create(&timerArgs, &ledTimer);
+}
+
+void ledNotifierShow(int greenBlinks, int redBlinks) {
+  if (ledTimer == NULL) {
+    return;
+  }
+  esp_timer_stop(ledTimer);  // Fails harmlessly if the timer is not running
+
+  portENTER_CRITICAL(&ledMux);
+  greenCount = max(greenBlinks, 0);
+  redCount = max(redBlinks, 0);
+  stepIndex = 0;
+  stepCount = 2 * (greenCount + redCount);
+  portEXIT_CRITICAL(&ledMux);
+
+  gpio_set_level(greenLed, LOW);
+  gpio_set_level(redLed, LOW);
+  if (stepCount > 0) {
+    esp_timer_start_periodic(ledTimer, blinkPeriodUs);
+  }
+}
+
+bool ledNotifierBusy() {
+  portENTER_CRITICAL(&ledMux);
+  bool busy = stepIndex < stepCount;
+  portEXIT_CRITICAL(&ledMux);
+  return busy;
+}
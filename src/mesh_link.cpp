@@ -0,0 +1,63 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * ESP-NOW link between the scanner nodes of one room
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <esp_now.h>
+
+#include "ring_buffer.h"
+#include "mesh_link.h"
+
+static const uint8_t BROADCAST[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+// WiFi task -> aggregation task, a head merges several hundred devices in a few messages per node
+static RingBuffer<MeshPacket, 16> received;
+
+static void onReceive(const uint8_t*, const uint8_t* data, int length) {
+  if (length <= 0 || (size_t)length > MESH_MESSAGE_MAX) {
+    return;
+  }
+  MeshPacket* packet = received.acquire();
+  if (packet == nullptr) {
+    return;  // Queue full, counted in received.dropped()
+  }
+  packet->length = (uint8_t)length;
+  memcpy(packet->data, data, length);
+  received.commit();
+}
+
+bool meshLinkBegin(uint8_t channel, bool receive) {
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect();
+  if (esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE) != ESP_OK || esp_now_init() != ESP_OK) {
+    return false;
+  }
+  esp_now_peer_info_t peer = {};
+  memcpy(peer.peer_addr, BROADCAST, sizeof(BROADCAST));
+  peer.channel = channel;
+  peer.encrypt = false;
+  if (esp_now_add_peer(&peer) != ESP_OK) {
+    return false;
+  }
+  return !receive || esp_now_register_recv_cb(onReceive) == ESP_OK;
+}
+
+bool meshLinkSend(const uint8_t* data, size_t length) {
+  return esp_now_send(BROADCAST, data, length) == ESP_OK;
+}
+
+bool meshLinkReceive(MeshPacket& packet) {
+  return received.pop(packet);
+}
+
+uint32_t meshLinkDropped() {
+  return received.dropped();
+}
@@ -0,0 +1,52 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Multi-scanner message format
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "mesh_protocol.h"
+
+uint32_t meshAddressHash(MacKey address) {
+  return (uint32_t)((address * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+size_t meshEncode(uint8_t node, uint8_t sequence, const MeshReport* reports, size_t count, uint8_t* out) {
+  out[0] = MESH_VERSION;
+  out[1] = node;
+  out[2] = sequence;
+  out[3] = (uint8_t)count;
+  uint8_t* p = &out[MESH_HEADER_SIZE];
+  for (size_t i = 0; i < count; i++) {
+    p[0] = (uint8_t)reports[i].hash;
+    p[1] = (uint8_t)(reports[i].hash >> 8);
+    p[2] = (uint8_t)(reports[i].hash >> 16);
+    p[3] = (uint8_t)(reports[i].hash >> 24);
+    p[4] = (uint8_t)reports[i].rssi;
+    p[5] = reports[i].age;
+    p += MESH_REPORT_SIZE;
+  }
+  return MESH_HEADER_SIZE + count * MESH_REPORT_SIZE;
+}
+
+size_t meshDecode(const uint8_t* data, size_t length, uint8_t* node, MeshReport* reports) {
+  if (length < MESH_HEADER_SIZE || data[0] != MESH_VERSION) {
+    return 0;
+  }
+  size_t count = data[3];
+  if (count > MESH_REPORTS_MAX || length != MESH_HEADER_SIZE + count * MESH_REPORT_SIZE) {
+    return 0;
+  }
+  *node = data[1];
+  const uint8_t* p = &data[MESH_HEADER_SIZE];
+  for (size_t i = 0; i < count; i++) {
+    reports[i].hash = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    reports[i].rssi = (int8_t)p[4];
+    reports[i].age = p[5];
+    p += MESH_REPORT_SIZE;
+  }
+  return count;
+}
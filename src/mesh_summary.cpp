@@ -0,0 +1,52 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Multi-scanner reports of one node (only changed devices are sent)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <stdlib.h>
+
+#include "mesh_summary.h"
+
+MeshSummarizer::MeshSummarizer() : m_refreshMs(5000), m_rssiStep(2), m_sequence(0), m_reports(0) {
+  for (size_t i = 0; i < PresenceTable::CAPACITY; i++) {
+    m_reported[i].hash = 0;
+  }
+}
+
+void MeshSummarizer::configure(uint32_t refreshMs, uint8_t rssiStep) {
+  m_refreshMs = refreshMs;
+  m_rssiStep = rssiStep;
+}
+
+size_t MeshSummarizer::build(const PresenceTable& table, uint8_t node, uint32_t nowMs, uint8_t* out) {
+  MeshReport reports[MESH_REPORTS_MAX];
+  size_t count = 0;
+  for (const PresenceEntry* entry = table.oldest(); entry != nullptr && count < MESH_REPORTS_MAX;
+       entry = table.newer(entry)) {
+    Reported& reported = m_reported[table.indexOf(entry)];
+    uint32_t hash = meshAddressHash(entry->address);
+    int rssi = (entry->rssi.estimateQ4 + 8) >> 4;
+    if (hash == reported.hash && abs(rssi - reported.rssi) < m_rssiStep && nowMs - reported.timeMs < m_refreshMs) {
+      continue;
+    }
+    uint32_t age = (nowMs - entry->lastSeenMs) / MESH_AGE_UNIT_MS;
+    reports[count].hash = hash;
+    reports[count].rssi = (int8_t)rssi;
+    reports[count].age = (age < MESH_AGE_MAX) ? (uint8_t)age : MESH_AGE_MAX;
+    count++;
+
+    reported.hash = hash;
+    reported.timeMs = nowMs;
+    reported.rssi = (int8_t)rssi;
+  }
+  if (count == 0) {
+    return 0;
+  }
+  m_reports += count;
+  return meshEncode(node, m_sequence++, reports, count, out);
+}
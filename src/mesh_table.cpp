@@ -0,0 +1,177 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Merged presence of all scanner nodes (chained hash over a preallocated entry pool)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "mesh_table.h"
+
+MeshTable::MeshTable() : m_ttlMs(15000), m_threshold(-80), m_thresholdFootstep(-50) {
+  clear();
+}
+
+void MeshTable::clear() {
+  for (size_t i = 0; i < BUCKETS; i++) {
+    m_buckets[i] = NONE;
+  }
+  for (size_t i = 0; i < CAPACITY; i++) {
+    m_entries[i].next = (i + 1 < CAPACITY) ? (uint16_t)(i + 1) : NONE;
+  }
+  m_freeHead = 0;
+  m_lruHead = NONE;
+  m_lruTail = NONE;
+  m_size = 0;
+  m_count = 0;
+  m_countFootstep = 0;
+  m_evictions = 0;
+  m_messages = 0;
+}
+
+void MeshTable::configure(uint32_t ttlMs) {
+  m_ttlMs = ttlMs;
+}
+
+void MeshTable::setThresholds(int threshold, int thresholdFootstep) {
+  if (threshold == m_threshold && thresholdFootstep == m_thresholdFootstep) {
+    return;
+  }
+  m_threshold = threshold;
+  m_thresholdFootstep = thresholdFootstep;
+  for (uint16_t i = m_lruHead; i != NONE; i = m_entries[i].lruNext) {
+    setRanges(m_entries[i], rangesOf(m_entries[i].rssi));
+  }
+}
+
+uint8_t MeshTable::rangesOf(int8_t rssi) const {
+  uint8_t ranges = 0;
+  if (rssi > m_threshold) {
+    ranges |= RANGE_NORMAL;
+  }
+  if (rssi > m_thresholdFootstep) {
+    ranges |= RANGE_FOOTSTEP;
+  }
+  return ranges;
+}
+
+void MeshTable::setRanges(MeshEntry& entry, uint8_t ranges) {
+  uint8_t changed = entry.ranges ^ ranges;
+  if (changed & RANGE_NORMAL) {
+    m_count += (ranges & RANGE_NORMAL) ? 1 : -1;
+  }
+  if (changed & RANGE_FOOTSTEP) {
+    m_countFootstep += (ranges & RANGE_FOOTSTEP) ? 1 : -1;
+  }
+  entry.ranges = ranges;
+}
+
+void MeshTable::lruUnlink(uint16_t index) {
+  MeshEntry& entry = m_entries[index];
+  if (entry.lruPrev != NONE) {
+    m_entries[entry.lruPrev].lruNext = entry.lruNext;
+  } else {
+    m_lruHead = entry.lruNext;
+  }
+  if (entry.lruNext != NONE) {
+    m_entries[entry.lruNext].lruPrev = entry.lruPrev;
+  } else {
+    m_lruTail = entry.lruPrev;
+  }
+}
+
+void MeshTable::lruAppend(uint16_t index) {
+  MeshEntry& entry = m_entries[index];
+  entry.lruPrev = m_lruTail;
+  entry.lruNext = NONE;
+  if (m_lruTail != NONE) {
+    m_entries[m_lruTail].lruNext = index;
+  } else {
+    m_lruHead = index;
+  }
+  m_lruTail = index;
+}
+
+void MeshTable::removeEntry(uint16_t index) {
+  MeshEntry& entry = m_entries[index];
+  setRanges(entry, 0);
+  lruUnlink(index);
+  uint16_t* link = &m_buckets[bucketOf(entry.hash)];
+  while (*link != index) {
+    link = &m_entries[*link].next;
+  }
+  *link = entry.next;
+  entry.next = m_freeHead;
+  m_freeHead = index;
+  m_size--;
+}
+
+bool MeshTable::apply(const uint8_t* message, size_t length, uint32_t nowMs) {
+  MeshReport reports[MESH_REPORTS_MAX];
+  uint8_t node;
+  size_t count = meshDecode(message, length, &node, reports);
+  if (count == 0) {
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    report(node, reports[i], nowMs);
+  }
+  m_messages++;
+  return true;
+}
+
+// The strongest RSSI wins. It is kept while its node keeps reporting the device, a weaker node takes over
+// once the strongest one has not reported it for half the TTL (the device walked away from that node)
+void MeshTable::report(uint8_t node, const MeshReport& report, uint32_t nowMs) {
+  uint32_t seenMs = nowMs - (uint32_t)report.age * MESH_AGE_UNIT_MS;
+  size_t bucket = bucketOf(report.hash);
+
+  uint16_t index = m_buckets[bucket];
+  while (index != NONE && m_entries[index].hash != report.hash) {
+    index = m_entries[index].next;
+  }
+
+  if (index == NONE) {
+    if (m_freeHead == NONE) {
+      removeEntry(m_lruHead);
+      m_evictions++;
+    }
+    index = m_freeHead;
+    MeshEntry& entry = m_entries[index];
+    m_freeHead = entry.next;
+    entry.hash = report.hash;
+    entry.seenMs = seenMs;
+    entry.bestMs = nowMs;
+    entry.rssi = report.rssi;
+    entry.node = node;
+    entry.ranges = 0;
+    entry.next = m_buckets[bucket];
+    m_buckets[bucket] = index;
+    lruAppend(index);
+    m_size++;
+    setRanges(entry, rangesOf(entry.rssi));
+    return;
+  }
+
+  MeshEntry& entry = m_entries[index];
+  if (node == entry.node || report.rssi >= entry.rssi || nowMs - entry.bestMs > m_ttlMs / 2) {
+    entry.rssi = report.rssi;
+    entry.node = node;
+    entry.bestMs = nowMs;
+    setRanges(entry, rangesOf(entry.rssi));
+  }
+  if ((int32_t)(seenMs - entry.seenMs) > 0) {
+    entry.seenMs = seenMs;
+  }
+  lruUnlink(index);
+  lruAppend(index);
+}
+
+void MeshTable::expire(uint32_t nowMs) {
+  // Ordered by report time => an outdated entry behind a fresher one goes once it reaches the oldest end
+  while (m_lruHead != NONE && nowMs - m_entries[m_lruHead].seenMs > m_ttlMs) {
+    removeEntry(m_lruHead);
+  }
+}
@@ -0,0 +1,66 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Occupancy trend (exponential moving averages over one second samples)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "occupancy_trend.h"
+
+OccupancyTrend::OccupancyTrend()
+    : m_window(30), m_sampleMs(0), m_started(false), m_arrivals(0), m_departures(0), m_dwellTotalMs(0),
+      m_arrivalRateQ8(0), m_departureRateQ8(0), m_dwellQ8(0) {}
+
+void OccupancyTrend::configure(uint16_t windowS) {
+  m_window = (windowS > 0) ? windowS : 1;
+}
+
+void OccupancyTrend::update(uint32_t nowMs, uint32_t arrivals, uint32_t departures, uint64_t dwellTotalMs) {
+  if (!m_started) {
+    m_started = true;
+    m_sampleMs = nowMs;
+    m_arrivals = arrivals;
+    m_departures = departures;
+    m_dwellTotalMs = dwellTotalMs;
+    return;
+  }
+  if (nowMs - m_sampleMs < SAMPLE_MS) {
+    return;
+  }
+  m_sampleMs += SAMPLE_MS;
+
+  // One second of events => x 600 is per minute x 10
+  int32_t arrived = (int32_t)(arrivals - m_arrivals);
+  int32_t departed = (int32_t)(departures - m_departures);
+  m_arrivalRateQ8 += (arrived * 600 * 256 - m_arrivalRateQ8) / m_window;
+  m_departureRateQ8 += (departed * 600 * 256 - m_departureRateQ8) / m_window;
+
+  if (departed > 0) {
+    int32_t dwellS = (int32_t)((dwellTotalMs - m_dwellTotalMs) / (uint32_t)departed / 1000);
+    int32_t weight = (departed < (int32_t)DWELL_WEIGHT) ? departed : (int32_t)DWELL_WEIGHT;
+    m_dwellQ8 += (dwellS * 256 - m_dwellQ8) * weight / (int32_t)DWELL_WEIGHT;
+  }
+  m_arrivals = arrivals;
+  m_departures = departures;
+  m_dwellTotalMs = dwellTotalMs;
+
+  // Far behind (first pass after a long stall) => restart the sample clock instead of catching up
+  if (nowMs - m_sampleMs >= SAMPLE_MS) {
+    m_sampleMs = nowMs;
+  }
+}
+
+uint16_t OccupancyTrend::arrivalRate() const {
+  return saturate((m_arrivalRateQ8 + 128) >> 8);
+}
+
+uint16_t OccupancyTrend::departureRate() const {
+  return saturate((m_departureRateQ8 + 128) >> 8);
+}
+
+uint16_t OccupancyTrend::meanDwell() const {
+  return saturate((m_dwellQ8 + 128) >> 8);
+}
@@ -0,0 +1,77 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Power management (esp_pm locks or the CPU clock, driven by the scan scheduler)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <Arduino.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+
+#include "power_manager.h"
+
+static const int MAX_FREQ_MHZ = 240;
+static const int MIN_FREQ_MHZ = 80;   // Lowest clock with a running BLE controller (APB at 80 MHz)
+
+static esp_pm_lock_handle_t cpuLock = NULL;
+static esp_pm_lock_handle_t sleepLock = NULL;
+static bool clockScaling = false;   // No esp_pm in the core => the clock is switched directly
+static bool active = false;
+
+// Stock core fallback, keeps the CPU at full clock until the scheduler reports an empty room
+static uint8_t beginClockScaling() {
+  cpuLock = NULL;
+  sleepLock = NULL;
+  clockScaling = true;
+  active = false;
+  powerSetActive(true);
+  return POWER_SCALING;
+}
+
+uint8_t powerBegin(uint8_t mode, int wakePin) {
+  if (mode == POWER_FULL) {
+    return POWER_FULL;
+  }
+  esp_pm_config_esp32_t pm;
+  pm.max_freq_mhz = MAX_FREQ_MHZ;
+  pm.min_freq_mhz = MIN_FREQ_MHZ;
+  pm.light_sleep_enable = mode == POWER_LIGHT_SLEEP;
+  if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "audience", &cpuLock) != ESP_OK ||
+      esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "audience", &sleepLock) != ESP_OK) {
+    return beginClockScaling();
+  }
+  // Awake and at full clock until the scheduler reports an empty room
+  powerSetActive(true);
+  if (esp_pm_configure(&pm) != ESP_OK) {
+    return beginClockScaling();   // The locks do nothing without esp_pm
+  }
+
+  // The I2C slave does not run in light sleep => the start condition of the master wakes the CPU,
+  // the master has to repeat a read that failed the frame CRC
+  if (mode == POWER_LIGHT_SLEEP && wakePin >= 0) {
+    gpio_wakeup_enable((gpio_num_t)wakePin, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+  }
+  return mode;
+}
+
+void powerSetActive(bool wanted) {
+  if ((cpuLock == NULL && !clockScaling) || wanted == active) {
+    return;
+  }
+  active = wanted;
+  if (clockScaling) {
+    setCpuFrequencyMhz(active ? MAX_FREQ_MHZ : MIN_FREQ_MHZ);
+  } else if (active) {
+    esp_pm_lock_acquire(cpuLock);
+    esp_pm_lock_acquire(sleepLock);
+  } else {
+    esp_pm_lock_release(sleepLock);
+    esp_pm_lock_release(cpuLock);
+  }
+}
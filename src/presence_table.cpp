@@ -0,0 +1,319 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Sliding window presence estimator (chained hash over a preallocated entry pool)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <stdlib.h>
+
+#include "presence_table.h"
+
+PresenceTable::PresenceTable()
+    : m_ttlMs(15000), m_threshold(-80), m_thresholdFootstep(-50) {
+  RssiFilterConfig filter = { 1, 16, 8 };
+  m_filter = filter;
+  clear();
+}
+
+void PresenceTable::clear() {
+  for (size_t i = 0; i < BUCKETS; i++) {
+    m_buckets[i] = NONE;
+    m_fingerprintBuckets[i] = NONE;
+  }
+  // Every entry starts on the free list (chained through next)
+  for (size_t i = 0; i < CAPACITY; i++) {
+    m_entries[i].next = (i + 1 < CAPACITY) ? (uint16_t)(i + 1) : NONE;
+  }
+  m_freeHead = (CAPACITY > 0) ? 0 : NONE;
+  m_lruHead = NONE;
+  m_lruTail = NONE;
+  m_size = 0;
+  m_count = 0;
+  m_countFootstep = 0;
+  m_evictions = 0;
+  m_takeovers = 0;
+  m_arrivals = 0;
+  m_departures = 0;
+  m_dwellTotalMs = 0;
+}
+
+void PresenceTable::configure(uint32_t ttlMs, const RssiFilterConfig& filter) {
+  m_ttlMs = ttlMs;
+  m_filter = filter;
+}
+
+void PresenceTable::setThresholds(int threshold, int thresholdFootstep) {
+  if (threshold == m_threshold && thresholdFootstep == m_thresholdFootstep) {
+    return;
+  }
+  m_threshold = threshold;
+  m_thresholdFootstep = thresholdFootstep;
+  for (uint16_t i = m_lruHead; i != NONE; i = m_entries[i].lruNext) {
+    setRanges(m_entries[i], rangesOf(m_entries[i].rssi.estimateQ4));
+  }
+}
+
+size_t PresenceTable::bucketOf(MacKey address) {
+  return (size_t)((address * 0x9E3779B97F4A7C15ULL) >> 40) & (BUCKETS - 1);
+}
+
+uint8_t PresenceTable::rangesOf(int16_t rssiQ4) const {
+  uint8_t ranges = 0;
+  if (rssiQ4 > m_threshold * 16) {
+    ranges |= RANGE_NORMAL;
+  }
+  if (rssiQ4 > m_thresholdFootstep * 16) {
+    ranges |= RANGE_FOOTSTEP;
+  }
+  return ranges;
+}
+
+// Keep the radius counts in step with the ranges of an entry
+void PresenceTable::setRanges(PresenceEntry& entry, uint8_t ranges) {
+  if ((ranges & RANGE_NORMAL) && !(entry.ranges & RANGE_ARRIVED)) {
+    m_arrivals++;
+  }
+  ranges |= entry.ranges & RANGE_ARRIVED;
+  if (ranges & RANGE_NORMAL) {
+    ranges |= RANGE_ARRIVED;
+  }
+  uint8_t changed = entry.ranges ^ ranges;
+  if (changed & RANGE_NORMAL) {
+    m_count += (ranges & RANGE_NORMAL) ? 1 : -1;
+  }
+  if (changed & RANGE_FOOTSTEP) {
+    m_countFootstep += (ranges & RANGE_FOOTSTEP) ? 1 : -1;
+  }
+  entry.ranges = ranges;
+}
+
+void PresenceTable::lruUnlink(uint16_t index) {
+  PresenceEntry& entry = m_entries[index];
+  if (entry.lruPrev != NONE) {
+    m_entries[entry.lruPrev].lruNext = entry.lruNext;
+  } else {
+    m_lruHead = entry.lruNext;
+  }
+  if (entry.lruNext != NONE) {
+    m_entries[entry.lruNext].lruPrev = entry.lruPrev;
+  } else {
+    m_lruTail = entry.lruPrev;
+  }
+}
+
+void PresenceTable::lruAppend(uint16_t index) {
+  PresenceEntry& entry = m_entries[index];
+  entry.lruPrev = m_lruTail;
+  entry.lruNext = NONE;
+  if (m_lruTail != NONE) {
+    m_entries[m_lruTail].lruNext = index;
+  } else {
+    m_lruHead = index;
+  }
+  m_lruTail = index;
+}
+
+void PresenceTable::unlinkBucket(uint16_t index) {
+  uint16_t* link = &m_buckets[bucketOf(m_entries[index].address)];
+  while (*link != index) {
+    link = &m_entries[*link].next;
+  }
+  *link = m_entries[index].next;
+}
+
+// Entries with a fingerprint are also chained by it, so an address rotation finds its device directly
+void PresenceTable::linkFingerprint(uint16_t index) {
+  PresenceEntry& entry = m_entries[index];
+  if (entry.fingerprint == 0) {
+    return;
+  }
+  size_t bucket = fingerprintBucketOf(entry.fingerprint);
+  entry.fingerprintNext = m_fingerprintBuckets[bucket];
+  m_fingerprintBuckets[bucket] = index;
+}
+
+void PresenceTable::unlinkFingerprint(uint16_t index) {
+  if (m_entries[index].fingerprint == 0) {
+    return;
+  }
+  uint16_t* link = &m_fingerprintBuckets[fingerprintBucketOf(m_entries[index].fingerprint)];
+  while (*link != index) {
+    link = &m_entries[*link].fingerprintNext;
+  }
+  *link = m_entries[index].fingerprintNext;
+}
+
+// A device that had been in the audience is gone
+void PresenceTable::departed(uint16_t index) {
+  const PresenceEntry& entry = m_entries[index];
+  if (entry.ranges & RANGE_ARRIVED) {
+    m_departures++;
+    m_dwellTotalMs += entry.lastSeenMs - entry.firstSeenMs;
+  }
+}
+
+void PresenceTable::removeEntry(uint16_t index) {
+  PresenceEntry& entry = m_entries[index];
+  setRanges(entry, 0);
+  lruUnlink(index);
+  unlinkBucket(index);
+  unlinkFingerprint(index);
+
+  entry.next = m_freeHead;
+  m_freeHead = index;
+  m_size--;
+}
+
+const PresenceEntry* PresenceTable::find(MacKey address) const {
+  for (uint16_t i = m_buckets[bucketOf(address)]; i != NONE; i = m_entries[i].next) {
+    if (m_entries[i].address == address) {
+      return &m_entries[i];
+    }
+  }
+  return nullptr;
+}
+
+// Eviction policy: among the EVICTION_PROBE least recently seen devices, drop the oldest one that is
+// outside of the normal radius (it does not change any count). If all of them are counted, drop the
+// least recently seen one. The probe is bounded, so eviction stays O(1) however crowded the room is
+uint16_t PresenceTable::evictionCandidate() const {
+  uint16_t index = m_lruHead;
+  for (size_t probe = 0; probe < EVICTION_PROBE && index != NONE; probe++) {
+    if ((m_entries[index].ranges & RANGE_NORMAL) == 0) {
+      return index;
+    }
+    index = m_entries[index].lruNext;
+  }
+  return m_lruHead;
+}
+
+// A better TX power source (advertised TX power over the class default) replaces the entry's one,
+// the smoothed RSSI is shifted by the change of the correction so it stays continuous
+void PresenceTable::adoptTxPower(PresenceEntry& entry, const DeviceRecord& record) {
+  if (record.txSource < entry.txSource || record.txPower == entry.txPower) {
+    return;
+  }
+  int shift = rssiCorrected(record.rssi, record.txPower, m_filter) - rssiCorrected(record.rssi, entry.txPower, m_filter);
+  entry.rssi.estimateQ4 = (int16_t)(entry.rssi.estimateQ4 + shift * 16);
+  entry.rssi.recent[0] = (int8_t)(entry.rssi.recent[0] + shift);
+  entry.rssi.recent[1] = (int8_t)(entry.rssi.recent[1] + shift);
+  entry.txPower = record.txPower;
+  entry.txSource = record.txSource;
+}
+
+// New advert of a tracked device: smooth the RSSI and make it the most recently seen entry
+void PresenceTable::refresh(uint16_t index, const DeviceRecord& record) {
+  PresenceEntry& entry = m_entries[index];
+  adoptTxPower(entry, record);
+  rssiFilterUpdate(entry.rssi, rssiCorrected(record.rssi, entry.txPower, m_filter), m_filter);
+  entry.lastSeenMs = record.timeMs;
+  if (record.fingerprint != 0 && record.fingerprint != entry.fingerprint) {
+    unlinkFingerprint(index);
+    entry.fingerprint = record.fingerprint;
+    linkFingerprint(index);
+  }
+  setRanges(entry, rangesOf(entry.rssi.estimateQ4));
+  lruUnlink(index);
+  lruAppend(index);
+}
+
+const PresenceEntry* PresenceTable::update(const DeviceRecord& record, bool* isNew) {
+  size_t bucket = bucketOf(record.address);
+
+  for (uint16_t i = m_buckets[bucket]; i != NONE; i = m_entries[i].next) {
+    if (m_entries[i].address == record.address) {
+      refresh(i, record);
+      *isNew = false;
+      return &m_entries[i];
+    }
+  }
+
+  // Table full -> evict a device (see evictionCandidate)
+  if (m_freeHead == NONE) {
+    if (m_lruHead == NONE) {
+      return nullptr;
+    }
+    uint16_t evicted = evictionCandidate();
+    departed(evicted);
+    removeEntry(evicted);
+    m_evictions++;
+  }
+
+  uint16_t index = m_freeHead;
+  PresenceEntry& entry = m_entries[index];
+  m_freeHead = entry.next;
+
+  entry.address = record.address;
+  entry.firstSeenMs = record.timeMs;
+  entry.lastSeenMs = record.timeMs;
+  entry.fingerprint = record.fingerprint;
+  entry.txPower = record.txPower;
+  entry.txSource = record.txSource;
+  rssiFilterReset(entry.rssi, rssiCorrected(record.rssi, record.txPower, m_filter), m_filter);
+  entry.addressType = record.addressType;
+  entry.ranges = 0;
+  entry.next = m_buckets[bucket];
+  m_buckets[bucket] = index;
+  linkFingerprint(index);
+  lruAppend(index);
+  m_size++;
+  setRanges(entry, rangesOf(entry.rssi.estimateQ4));
+
+  *isNew = true;
+  return &entry;
+}
+
+void PresenceTable::expire(uint32_t nowMs) {
+  // The LRU list is ordered by last-seen time, so only the oldest entries have to be checked
+  while (m_lruHead != NONE && (uint32_t)(nowMs - m_entries[m_lruHead].lastSeenMs) > m_ttlMs) {
+    departed(m_lruHead);
+    removeEntry(m_lruHead);
+  }
+}
+
+bool PresenceTable::mergeRotation(MacKey address, uint32_t nowMs, uint32_t minGapMs, int rssiTolerance,
+                                  MacKey* retired) {
+  const PresenceEntry* found = find(address);
+  if (found == nullptr || found->fingerprint == 0 || nowMs - found->firstSeenMs > 2 * minGapMs) {
+    return false;   // Only a young entry can be the new address of a rotation
+  }
+  uint16_t current = (uint16_t)(found - m_entries);
+  PresenceEntry& entry = m_entries[current];
+
+  // Only entries with the same fingerprint can be the device; the old address stops right before the
+  // new one starts (no overlap), the most recently seen candidate is the best handover
+  uint16_t match = NONE;
+  uint16_t index = m_fingerprintBuckets[fingerprintBucketOf(entry.fingerprint)];
+  for (size_t probe = 0; probe < ROTATION_PROBE && index != NONE; probe++) {
+    const PresenceEntry& candidate = m_entries[index];
+    int32_t handoverMs = (int32_t)(entry.firstSeenMs - candidate.lastSeenMs);
+    if (index != current && candidate.fingerprint == entry.fingerprint &&
+        candidate.addressType == entry.addressType && handoverMs > 0 && (uint32_t)handoverMs <= minGapMs &&
+        nowMs - candidate.lastSeenMs >= minGapMs &&
+        abs(candidate.rssi.estimateQ4 - entry.rssi.estimateQ4) <= rssiTolerance * 16 &&
+        (match == NONE || (int32_t)(candidate.lastSeenMs - m_entries[match].lastSeenMs) > 0)) {
+      match = index;
+    }
+    index = candidate.fingerprintNext;
+  }
+  if (match == NONE) {
+    return false;
+  }
+
+  // Still the same visitor => one arrival, no departure
+  *retired = m_entries[match].address;
+  entry.firstSeenMs = m_entries[match].firstSeenMs;
+  if (m_entries[match].ranges & RANGE_ARRIVED) {
+    if (entry.ranges & RANGE_ARRIVED) {
+      m_arrivals--;
+    }
+    entry.ranges |= RANGE_ARRIVED;
+  }
+  removeEntry(match);
+  m_takeovers++;
+  return true;
+}
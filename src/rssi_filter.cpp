@@ -0,0 +1,57 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * RSSI smoothing (median of three + scalar Kalman filter) and transmit power correction
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "rssi_filter.h"
+
+static const uint16_t VARIANCE_MAX_Q4 = 0xFFFF;
+
+static inline int8_t median3(int8_t a, int8_t b, int8_t c) {
+  if (a > b) {
+    int8_t t = a;
+    a = b;
+    b = t;
+  }
+  return (c <= a) ? a : (c >= b) ? b : c;
+}
+
+int8_t rssiCorrected(int8_t rssi, int8_t txPower, const RssiFilterConfig& config) {
+  if (txPower == TX_POWER_UNKNOWN) {
+    return rssi;
+  }
+  int correction = config.txPowerReference - txPower;
+  if (correction > TX_CORRECTION_LIMIT) correction = TX_CORRECTION_LIMIT;
+  if (correction < -TX_CORRECTION_LIMIT) correction = -TX_CORRECTION_LIMIT;
+  int corrected = rssi + correction;
+  return (int8_t)(corrected < -127 ? -127 : corrected > 20 ? 20 : corrected);
+}
+
+void rssiFilterReset(RssiFilterState& state, int8_t sample, const RssiFilterConfig& config) {
+  state.estimateQ4 = (int16_t)(sample * 16);
+  state.varianceQ4 = (uint16_t)(config.measurementNoise * 16);
+  state.recent[0] = sample;
+  state.recent[1] = sample;
+}
+
+int16_t rssiFilterUpdate(RssiFilterState& state, int8_t sample, const RssiFilterConfig& config) {
+  int8_t measured = median3(state.recent[0], state.recent[1], sample);
+  state.recent[0] = state.recent[1];
+  state.recent[1] = sample;
+
+  // Predict: the device may have moved since the last sample
+  uint32_t predicted = (uint32_t)state.varianceQ4 + config.processNoise * 16;
+  if (predicted > VARIANCE_MAX_Q4) predicted = VARIANCE_MAX_Q4;
+
+  // Update: gain K = P / (P + R) in 1/256
+  uint32_t gain = (predicted << 8) / (predicted + config.measurementNoise * 16 + 1);
+  int32_t innovation = measured * 16 - state.estimateQ4;
+  state.estimateQ4 = (int16_t)(state.estimateQ4 + (innovation * (int32_t)gain) / 256);
+  state.varianceQ4 = (uint16_t)((predicted * (256 - gain)) >> 8);
+  return state.estimateQ4;
+}
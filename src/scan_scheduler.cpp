@@ -0,0 +1,89 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Occupancy driven scan duty-cycle scheduler
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "scan_scheduler.h"
+
+static bool sameSettings(const ScanSettings& a, const ScanSettings& b) {
+  return a.active == b.active && a.interval == b.interval && a.window == b.window &&
+         a.filterDuplicates == b.filterDuplicates && a.duplicateReset == b.duplicateReset &&
+         a.stallTimeout == b.stallTimeout && a.stallHold == b.stallHold;
+}
+
+ScanScheduler::ScanScheduler()
+    : m_idle(false), m_windowPercent(100), m_lastPresenceMs(0),
+      m_rateStartMs(0), m_rateAdverts(0), m_advertRate(0) {
+  ScanSettings present = { true, 25, 24, false, 2000, 5000, 15000 };
+  ScanSettings idle = { false, 320, 32, false, 2000, 5000, 15000 };
+  m_config.present = present;
+  m_config.idle = idle;
+  m_config.idleAfterMs = 60000;
+  m_config.busyAdvertRate = 400;
+  m_config.quietAdvertRate = 150;
+  m_config.minWindowPercent = 25;
+  m_settings = present;
+}
+
+void ScanScheduler::configure(const ScanSchedulerConfig& config, uint32_t nowMs) {
+  m_config = config;
+  m_idle = false;
+  m_windowPercent = 100;
+  m_lastPresenceMs = nowMs;
+  m_rateStartMs = nowMs;
+  m_rateAdverts = 0;
+  m_settings = presentSettings();
+}
+
+ScanSettings ScanScheduler::presentSettings() const {
+  ScanSettings settings = m_config.present;
+  uint32_t window = (uint32_t)settings.window * m_windowPercent / 100;
+  settings.window = (uint16_t)(window > 0 ? window : 1);
+  return settings;
+}
+
+bool ScanScheduler::update(uint32_t nowMs, bool presence, uint32_t adverts) {
+  // ***** Advert rate over the last second ***** //
+  m_rateAdverts += adverts;
+  bool rateUpdated = false;
+  uint32_t elapsed = nowMs - m_rateStartMs;
+  if (elapsed >= RATE_PERIOD_MS) {
+    uint32_t rate = m_rateAdverts * 1000 / elapsed;
+    m_advertRate = (uint16_t)(rate > 0xFFFF ? 0xFFFF : rate);
+    m_rateAdverts = 0;
+    m_rateStartMs = nowMs;
+    rateUpdated = true;
+  }
+
+  // ***** Occupancy ***** //
+  if (presence) {
+    m_lastPresenceMs = nowMs;
+    m_idle = false;
+  } else if (!m_idle && nowMs - m_lastPresenceMs >= m_config.idleAfterMs) {
+    m_idle = true;
+    m_windowPercent = 100;
+  }
+
+  // ***** Window retune from the advert rate (one step per second) ***** //
+  // The measured rate shrinks with the window, compare the rate the full window would see
+  if (!m_idle && rateUpdated) {
+    uint32_t fullRate = (uint32_t)m_advertRate * 100 / m_windowPercent;
+    if (fullRate > m_config.busyAdvertRate && m_windowPercent / 2 >= m_config.minWindowPercent) {
+      m_windowPercent /= 2;
+    } else if (fullRate < m_config.quietAdvertRate && m_windowPercent < 100) {
+      m_windowPercent = (m_windowPercent * 2 > 100) ? 100 : m_windowPercent * 2;
+    }
+  }
+
+  ScanSettings settings = m_idle ? m_config.idle : presentSettings();
+  if (sameSettings(settings, m_settings)) {
+    return false;
+  }
+  m_settings = settings;
+  return true;
+}
@@ -0,0 +1,78 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Scan pipeline watchdog
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "scan_watchdog.h"
+
+ScanWatchdog::ScanWatchdog() {
+  configure(0, 0);
+}
+
+void ScanWatchdog::configure(uint32_t stallTimeoutMs, uint32_t nowMs) {
+  m_stallTimeoutMs = stallTimeoutMs;
+  m_results = 0;
+  m_progressMs = nowMs;
+  m_runningMs = nowMs;
+  m_stalledMs = nowMs;
+  m_recoveryMs = 0;
+  m_level = 0;
+  m_backoff = 1;
+  m_recovered = false;
+}
+
+WatchdogAction ScanWatchdog::update(uint32_t nowMs, uint32_t results, bool running) {
+  if (running) {
+    m_runningMs = nowMs;
+  }
+  if (results != m_results) {
+    m_results = results;
+    m_progressMs = nowMs;
+    if (m_level != 0) {
+      m_recoveryMs = nowMs - m_stalledMs;
+      m_recovered = true;
+      m_level = 0;
+      m_backoff = 1;
+    }
+    return WATCHDOG_NONE;
+  }
+  if (m_stallTimeoutMs == 0) {
+    return WATCHDOG_NONE;
+  }
+
+  bool silent = nowMs - m_progressMs >= m_stallTimeoutMs * m_backoff;
+  bool down = !running && nowMs - m_runningMs >= START_TIMEOUT_MS;
+  if (!silent && !down) {
+    return WATCHDOG_NONE;
+  }
+
+  // Every step gets a full timeout to show progress before the next one
+  if (m_level == 0) {
+    m_stalledMs = nowMs;
+  }
+  m_progressMs = nowMs;
+  m_runningMs = nowMs;
+  if (m_level == 1) {
+    m_level = 2;
+    return WATCHDOG_REINIT_STACK;
+  }
+  if (m_level == 2 && m_backoff < MAX_BACKOFF) {
+    m_backoff *= 2;
+  }
+  m_level = 1;
+  return WATCHDOG_RESTART_SCAN;
+}
+
+bool ScanWatchdog::recovered(uint32_t* durationMs) {
+  if (!m_recovered) {
+    return false;
+  }
+  m_recovered = false;
+  *durationMs = m_recoveryMs;
+  return true;
+}
@@ -0,0 +1,126 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * BLE scanner front end on the Bluedroid GAP API
+  * BLEDevice only brings up the stack. BLEScan is never created, so the library neither parses
+  * nor stores adverts; scan results are read from the raw GAP event by a custom GAP handler.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#if !defined(SCANNER_BACKEND_NIMBLE)
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <esp_bt_main.h>
+#include <esp_gap_ble_api.h>
+
+#include "scanner.h"
+#include "hot_path.h"
+
+enum ScannerState : uint8_t { SCANNER_IDLE, SCANNER_STARTING, SCANNER_RUNNING };
+
+static ScanCallbacks* scanCallbacks = nullptr;
+static volatile ScannerState scannerState = SCANNER_IDLE;
+
+// GAP scan interval/window unit is 0.625 ms
+static uint16_t toGapUnits(uint16_t ms) {
+  uint32_t units = (uint32_t)ms * 8 / 5;
+  return (uint16_t)(units < 0x0004 ? 0x0004 : (units > 0x4000 ? 0x4000 : units));
+}
+
+static void SCANNER_HOT gapEventHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  switch (event) {
+    case ESP_GAP_BLE_SCAN_RESULT_EVT:
+      if (param->scan_rst.search_evt == ESP_GAP_SEARCH_INQ_RES_EVT) {
+        ScanResult result;
+        result.address = param->scan_rst.bda;
+        result.addressType = (uint8_t)param->scan_rst.ble_addr_type;
+        result.rssi = (int8_t)param->scan_rst.rssi;
+        result.payload = param->scan_rst.ble_adv;
+        result.payloadLength = param->scan_rst.adv_data_len + param->scan_rst.scan_rsp_len;
+        result.scanResponse = param->scan_rst.ble_evt_type == ESP_BLE_EVT_SCAN_RSP;
+        scanCallbacks->onResult(result);
+      } else if (param->scan_rst.search_evt == ESP_GAP_SEARCH_INQ_CMPL_EVT) {
+        scannerState = SCANNER_IDLE;
+      }
+      break;
+
+    case ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT:
+      // Duration 0 => scan until stopped
+      if (param->scan_param_cmpl.status != ESP_BT_STATUS_SUCCESS || esp_ble_gap_start_scanning(0) != ESP_OK) {
+        scannerState = SCANNER_IDLE;
+      }
+      break;
+
+    case ESP_GAP_BLE_SCAN_START_COMPLETE_EVT:
+      scannerState = (param->scan_start_cmpl.status == ESP_BT_STATUS_SUCCESS) ? SCANNER_RUNNING : SCANNER_IDLE;
+      break;
+
+    case ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT:
+      scannerState = SCANNER_IDLE;
+      break;
+
+    default:
+      break;
+  }
+}
+
+bool scannerBegin(ScanCallbacks* callbacks) {
+  scanCallbacks = callbacks;
+  BLEDevice::init("");
+  BLEDevice::setCustomGapHandler(gapEventHandler);
+  return true;
+}
+
+bool scannerStart(const ScanSettings& settings) {
+  if (scannerState != SCANNER_IDLE) {
+    return true;
+  }
+
+  esp_ble_scan_params_t params = {};
+  params.scan_type = settings.active ? BLE_SCAN_TYPE_ACTIVE : BLE_SCAN_TYPE_PASSIVE;
+  params.own_addr_type = BLE_ADDR_TYPE_PUBLIC;
+  params.scan_filter_policy = BLE_SCAN_FILTER_ALLOW_ALL;
+  params.scan_interval = toGapUnits(settings.interval);
+  params.scan_window = toGapUnits(min(settings.window, settings.interval));
+  params.scan_duplicate = settings.filterDuplicates ? BLE_SCAN_DUPLICATE_ENABLE : BLE_SCAN_DUPLICATE_DISABLE;
+
+  // Scanning starts once the controller confirmed the parameters (see gapEventHandler)
+  scannerState = SCANNER_STARTING;
+  if (esp_ble_gap_set_scan_params(&params) != ESP_OK) {
+    scannerState = SCANNER_IDLE;
+    return false;
+  }
+  return true;
+}
+
+void scannerStop() {
+  if (scannerState != SCANNER_IDLE) {
+    esp_ble_gap_stop_scanning();
+  }
+}
+
+bool scannerRunning() {
+  return scannerState != SCANNER_IDLE;
+}
+
+bool scannerRestart(const ScanSettings& settings) {
+  // A stalled controller may never report the stop => do not wait for ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT
+  esp_ble_gap_stop_scanning();
+  scannerState = SCANNER_IDLE;
+  return scannerStart(settings);
+}
+
+bool scannerReset() {
+  esp_ble_gap_stop_scanning();
+  scannerState = SCANNER_IDLE;
+  BLEDevice::deinit(false);   // false => keep the controller memory, so the stack can come up again
+  BLEDevice::init("");
+  BLEDevice::setCustomGapHandler(gapEventHandler);
+  return esp_bluedroid_get_status() == ESP_BLUEDROID_STATUS_ENABLED;
+}
+
+#endif
@@ -0,0 +1,229 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Runtime configuration of the scanner (defaults, validation, named field table)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <string.h>
+
+#include "scanner_config.h"
+#include "mesh_protocol.h"
+
+enum FieldType { FIELD_BOOL, FIELD_I8, FIELD_U8, FIELD_U16, FIELD_U32 };
+
+struct ConfigField {
+  const char* name;
+  uint16_t offset;
+  uint8_t type;
+  bool boot;        // Stored, applied after a restart
+  int32_t min;
+  int32_t max;
+};
+
+#define CONFIG_FIELD(member, type, boot, min, max) \
+  { #member, (uint16_t)offsetof(ScannerConfig, member), type, boot, min, max }
+
+// Field indices are part of the I2C register map => only ever append
+static const ConfigField FIELDS[] = {
+  CONFIG_FIELD(rssiThreshold, FIELD_I8, false, -127, 0),
+  CONFIG_FIELD(rssiThresholdFootstep, FIELD_I8, false, -127, 0),
+  CONFIG_FIELD(audienceSmallEnter, FIELD_U16, false, 1, 1000),
+  CONFIG_FIELD(audienceSmallExit, FIELD_U16, false, 1, 1000),
+  CONFIG_FIELD(audienceLargeEnter, FIELD_U16, false, 1, 1000),
+  CONFIG_FIELD(audienceLargeExit, FIELD_U16, false, 1, 1000),
+  CONFIG_FIELD(modeMinDwell, FIELD_U16, false, 0, 60000),
+  CONFIG_FIELD(activeScan, FIELD_BOOL, false, 0, 1),
+  CONFIG_FIELD(scanInterval, FIELD_U16, false, 3, 10240),
+  CONFIG_FIELD(scanWindow, FIELD_U16, false, 3, 10240),
+  CONFIG_FIELD(idleScanInterval, FIELD_U16, false, 3, 10240),
+  CONFIG_FIELD(idleScanWindow, FIELD_U16, false, 3, 10240),
+  CONFIG_FIELD(idleAfter, FIELD_U32, false, 0, 3600000),
+  CONFIG_FIELD(busyAdvertRate, FIELD_U16, false, 1, 10000),
+  CONFIG_FIELD(quietAdvertRate, FIELD_U16, false, 0, 10000),
+  CONFIG_FIELD(minWindowPercent, FIELD_U8, false, 1, 100),
+  CONFIG_FIELD(filterDuplicates, FIELD_BOOL, false, 0, 1),
+  CONFIG_FIELD(duplicateReset, FIELD_U16, false, 100, 60000),
+  CONFIG_FIELD(advertRateLimit, FIELD_U16, false, 0, 10000),
+  CONFIG_FIELD(presenceTtl, FIELD_U32, false, 1000, 600000),
+  CONFIG_FIELD(rssiMeasurementNoise, FIELD_U8, false, 1, 255),
+  CONFIG_FIELD(rotationMinGap, FIELD_U16, false, 0, 60000),
+  CONFIG_FIELD(rotationRssiTolerance, FIELD_U8, false, 0, 127),
+  CONFIG_FIELD(retiredMemory, FIELD_U32, false, 1000, 3600000),
+  CONFIG_FIELD(reportInterval, FIELD_U8, false, 1, 255),
+  CONFIG_FIELD(ledGreen, FIELD_I8, true, 0, 39),
+  CONFIG_FIELD(ledRed, FIELD_I8, true, 0, 39),
+  CONFIG_FIELD(ledBlinkTime, FIELD_U8, true, 1, 255),
+  CONFIG_FIELD(i2cAddress, FIELD_U8, true, 0x08, 0x77),
+  CONFIG_FIELD(dataReadyPin, FIELD_I8, true, -1, 33),
+  CONFIG_FIELD(dataReadyCountStep, FIELD_U8, false, 1, 255),
+  CONFIG_FIELD(calibrateOnBoot, FIELD_BOOL, true, 0, 1),
+  CONFIG_FIELD(calibrationMinutes, FIELD_U8, false, 1, 240),
+  CONFIG_FIELD(calibrationPresence, FIELD_U8, false, 1, 100),
+  CONFIG_FIELD(calibrationRssiSpread, FIELD_U8, false, 1, 40),
+  CONFIG_FIELD(rssiProcessNoise, FIELD_U8, false, 0, 255),
+  CONFIG_FIELD(txPowerReference, FIELD_I8, false, -40, 20),
+  CONFIG_FIELD(traceSizeKb, FIELD_U16, false, 16, 4096),
+  CONFIG_FIELD(tracePayload, FIELD_BOOL, false, 0, 1),
+  CONFIG_FIELD(meshRole, FIELD_U8, true, 0, 2),
+  CONFIG_FIELD(meshNodeId, FIELD_U8, false, 0, 255),
+  CONFIG_FIELD(meshChannel, FIELD_U8, true, 1, 13),
+  CONFIG_FIELD(meshInterval, FIELD_U16, false, 100, 10000),
+  CONFIG_FIELD(meshRefresh, FIELD_U16, false, 500, 60000),
+  CONFIG_FIELD(meshRssiStep, FIELD_U8, false, 1, 40),
+  CONFIG_FIELD(powerMode, FIELD_U8, true, 0, 2),
+  CONFIG_FIELD(trendWindow, FIELD_U16, false, 1, 600),
+  CONFIG_FIELD(scanStallTimeout, FIELD_U16, false, 0, 60000),
+};
+
+static const size_t FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+// ESP32 GPIOs that can drive an LED or the data-ready line. Not the SPI flash (6-11, the chip hangs at boot),
+// the input only pins (34-39), the serial port (1, 3), the I2C bus (21, 22) or pins that do not exist
+static const uint64_t OUTPUT_PINS = 0x30E8FF035ULL;   // 0, 2, 4, 5, 12-19, 23, 25-27, 32, 33
+
+static bool outputPin(int pin) {
+  return pin >= 0 && pin < 64 && ((OUTPUT_PINS >> pin) & 1) != 0;
+}
+
+void configDefaults(ScannerConfig& config) {
+  memset(&config, 0, sizeof(config));
+  config.rssiThreshold = -80;
+  config.rssiThresholdFootstep = -50;
+  config.audienceSmallEnter = 5;
+  config.audienceSmallExit = 4;
+  config.audienceLargeEnter = 16;
+  config.audienceLargeExit = 14;
+  config.modeMinDwell = 3000;
+
+  config.activeScan = true;
+  config.scanInterval = 25;
+  config.scanWindow = 24;
+  config.idleScanInterval = 320;
+  config.idleScanWindow = 32;       // 10% duty
+  config.idleAfter = 60000;
+  config.busyAdvertRate = 400;
+  config.quietAdvertRate = 150;
+  config.minWindowPercent = 25;
+
+  config.filterDuplicates = false;
+  config.duplicateReset = 2000;
+  config.advertRateLimit = 250;
+  config.scanStallTimeout = 5000;
+
+  config.presenceTtl = 15000;
+  config.rssiMeasurementNoise = 16;  // 4 dB standard deviation
+  config.rssiProcessNoise = 1;
+  config.txPowerReference = 8;
+  config.rotationMinGap = 1000;
+  config.rotationRssiTolerance = 10;
+  config.retiredMemory = 60000;
+  config.trendWindow = 30;
+
+  config.reportInterval = 5;
+  config.ledGreen = 18;
+  config.ledRed = 5;
+  config.ledBlinkTime = 15;
+  config.i2cAddress = 8;
+  config.dataReadyPin = -1;
+  config.dataReadyCountStep = 2;
+
+  config.calibrateOnBoot = false;
+  config.calibrationMinutes = 10;
+  config.calibrationPresence = 80;
+  config.calibrationRssiSpread = 6;
+
+  config.traceSizeKb = 512;
+  config.tracePayload = true;
+
+  config.meshRole = 0;
+  config.meshNodeId = 0;
+  config.meshChannel = 1;
+  config.meshInterval = 500;
+  config.meshRefresh = 5000;
+  config.meshRssiStep = 2;
+
+  config.powerMode = 0;
+}
+
+bool configValid(const ScannerConfig& config) {
+  for (size_t i = 0; i < FIELD_COUNT; i++) {
+    int32_t value = configFieldGet(config, i);
+    if (value < FIELDS[i].min || value > FIELDS[i].max) {
+      return false;
+    }
+  }
+  return config.scanWindow <= config.scanInterval &&
+         config.idleScanWindow <= config.idleScanInterval &&
+         config.audienceSmallExit <= config.audienceSmallEnter &&
+         config.audienceLargeExit <= config.audienceLargeEnter &&
+         config.audienceSmallEnter <= config.audienceLargeEnter &&
+         config.quietAdvertRate < config.busyAdvertRate &&
+         (config.meshRole == MESH_OFF || config.meshRefresh < config.presenceTtl) &&
+         config.scanStallTimeout < config.presenceTtl &&
+         outputPin(config.ledGreen) && outputPin(config.ledRed) && config.ledGreen != config.ledRed &&
+         (config.dataReadyPin < 0 || (outputPin(config.dataReadyPin) && config.dataReadyPin != config.ledGreen &&
+                                      config.dataReadyPin != config.ledRed));
+}
+
+size_t configFieldCount() {
+  return FIELD_COUNT;
+}
+
+const char* configFieldName(size_t field) {
+  return (field < FIELD_COUNT) ? FIELDS[field].name : nullptr;
+}
+
+bool configFieldFind(const char* name, size_t* field) {
+  for (size_t i = 0; i < FIELD_COUNT; i++) {
+    if (strcmp(FIELDS[i].name, name) == 0) {
+      *field = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool configFieldIsBoot(size_t field) {
+  return field < FIELD_COUNT && FIELDS[field].boot;
+}
+
+void configKeepBoot(ScannerConfig& config, const ScannerConfig& running) {
+  for (size_t i = 0; i < FIELD_COUNT; i++) {
+    if (FIELDS[i].boot) {
+      configFieldSet(config, i, configFieldGet(running, i));
+    }
+  }
+}
+
+int32_t configFieldGet(const ScannerConfig& config, size_t field) {
+  if (field >= FIELD_COUNT) {
+    return 0;
+  }
+  const uint8_t* member = (const uint8_t*)&config + FIELDS[field].offset;
+  switch (FIELDS[field].type) {
+    case FIELD_BOOL: return *(const bool*)member ? 1 : 0;
+    case FIELD_I8: return *(const int8_t*)member;
+    case FIELD_U8: return *member;
+    case FIELD_U16: return *(const uint16_t*)member;
+    default: return (int32_t)*(const uint32_t*)member;
+  }
+}
+
+bool configFieldSet(ScannerConfig& config, size_t field, int32_t value) {
+  if (field >= FIELD_COUNT || value < FIELDS[field].min || value > FIELDS[field].max) {
+    return false;
+  }
+  uint8_t* member = (uint8_t*)&config + FIELDS[field].offset;
+  switch (FIELDS[field].type) {
+    case FIELD_BOOL: *(bool*)member = value != 0; break;
+    case FIELD_I8: *(int8_t*)member = (int8_t)value; break;
+    case FIELD_U8: *member = (uint8_t)value; break;
+    case FIELD_U16: *(uint16_t*)member = (uint16_t)value; break;
+    default: *(uint32_t*)member = (uint32_t)value; break;
+  }
+  return true;
+}
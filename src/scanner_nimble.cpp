@@ -0,0 +1,119 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * BLE scanner front end on NimBLE (build flag SCANNER_BACKEND_NIMBLE)
+  * NimBLEDevice only brings up the host. Discovery runs on the raw ble_gap_disc() API,
+  * so adverts reach the callbacks without NimBLEAdvertisedDevice objects, same as the Bluedroid backend.
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#if defined(SCANNER_BACKEND_NIMBLE)
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+
+#include "scanner.h"
+#include "hot_path.h"
+
+// Roles come from nimconfig.h, a *_DISABLED build flag (env:release-small) has to remove the role there,
+// otherwise the profile would claim a size win it does not have
+#if !defined(CONFIG_BT_NIMBLE_ROLE_OBSERVER)
+#error "The NimBLE backend scans, it needs the observer role"
+#endif
+#if (defined(CONFIG_BT_NIMBLE_ROLE_CENTRAL_DISABLED) && defined(CONFIG_BT_NIMBLE_ROLE_CENTRAL)) || \
+    (defined(CONFIG_BT_NIMBLE_ROLE_PERIPHERAL_DISABLED) && defined(CONFIG_BT_NIMBLE_ROLE_PERIPHERAL)) || \
+    (defined(CONFIG_BT_NIMBLE_ROLE_BROADCASTER_DISABLED) && defined(CONFIG_BT_NIMBLE_ROLE_BROADCASTER))
+#error "A CONFIG_BT_NIMBLE_ROLE_*_DISABLED build flag did not reach the NimBLE config"
+#endif
+
+static ScanCallbacks* scanCallbacks = nullptr;
+static volatile bool scanActive = false;
+
+// GAP scan interval/window unit is 0.625 ms
+static uint16_t toGapUnits(uint16_t ms) {
+  uint32_t units = (uint32_t)ms * 8 / 5;
+  return (uint16_t)(units < 0x0004 ? 0x0004 : (units > 0x4000 ? 0x4000 : units));
+}
+
+static int SCANNER_HOT gapEventHandler(struct ble_gap_event* event, void*) {
+  switch (event->type) {
+    case BLE_GAP_EVENT_DISC: {
+      // NimBLE keeps addresses least significant byte first, the rest of the firmware uses display order
+      uint8_t address[6];
+      for (int i = 0; i < 6; i++) {
+        address[i] = event->disc.addr.val[5 - i];
+      }
+      ScanResult result;
+      result.address = address;
+      result.addressType = event->disc.addr.type;
+      result.rssi = event->disc.rssi;
+      result.payload = event->disc.data;
+      result.payloadLength = event->disc.length_data;
+      result.scanResponse = event->disc.event_type == BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP;
+      scanCallbacks->onResult(result);
+      break;
+    }
+
+    case BLE_GAP_EVENT_DISC_COMPLETE:
+      scanActive = false;
+      break;
+
+    default:
+      break;
+  }
+  return 0;
+}
+
+bool scannerBegin(ScanCallbacks* callbacks) {
+  scanCallbacks = callbacks;
+  NimBLEDevice::init("");
+  return true;
+}
+
+bool scannerStart(const ScanSettings& settings) {
+  if (scanActive) {
+    return true;
+  }
+
+  struct ble_gap_disc_params params = {};
+  params.itvl = toGapUnits(settings.interval);
+  params.window = toGapUnits(min(settings.window, settings.interval));
+  params.filter_policy = BLE_HCI_SCAN_FILT_NO_WL;
+  params.limited = 0;
+  params.passive = settings.active ? 0 : 1;
+  params.filter_duplicates = settings.filterDuplicates ? 1 : 0;
+
+  int rc = ble_gap_disc(BLE_OWN_ADDR_PUBLIC, BLE_HS_FOREVER, &params, gapEventHandler, NULL);
+  scanActive = (rc == 0 || rc == BLE_HS_EALREADY);
+  return scanActive;
+}
+
+void scannerStop() {
+  if (scanActive) {
+    ble_gap_disc_cancel();
+    scanActive = false;   // Cancelling does not report BLE_GAP_EVENT_DISC_COMPLETE
+  }
+}
+
+bool scannerRunning() {
+  return scanActive;
+}
+
+bool scannerRestart(const ScanSettings& settings) {
+  ble_gap_disc_cancel();
+  scanActive = false;
+  return scannerStart(settings);
+}
+
+bool scannerReset() {
+  ble_gap_disc_cancel();
+  scanActive = false;
+  NimBLEDevice::deinit(false);   // false => keep the controller memory, so the host can come up again
+  NimBLEDevice::init("");
+  return NimBLEDevice::getInitialized();
+}
+
+#endif
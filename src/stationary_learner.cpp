@@ -0,0 +1,84 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Stationary device learner (open addressing over a fixed candidate table)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "stationary_learner.h"
+
+static const MacKey EMPTY_SLOT = 0xFFFFFFFFFFFFFFFFULL;
+
+StationaryLearner::StationaryLearner()
+    : m_count(0), m_overflow(0), m_startMs(0), m_durationMs(0), m_running(false) {}
+
+void StationaryLearner::begin(uint32_t nowMs, uint32_t durationMs) {
+  for (size_t i = 0; i < SLOTS; i++) {
+    m_slots[i].address = EMPTY_SLOT;
+  }
+  m_count = 0;
+  m_overflow = 0;
+  m_startMs = nowMs;
+  m_durationMs = (durationMs > 0) ? durationMs : 1;
+  m_running = true;
+}
+
+void StationaryLearner::add(const DeviceRecord& record) {
+  if (!m_running) {
+    return;
+  }
+  uint32_t elapsed = record.timeMs - m_startMs;
+  if ((int32_t)elapsed < 0 || elapsed >= m_durationMs) {
+    return;
+  }
+  uint8_t window = (uint8_t)((uint64_t)elapsed * WINDOWS / m_durationMs);
+
+  size_t slot = (size_t)((record.address * 0x9E3779B97F4A7C15ULL) >> 40) & (SLOTS - 1);
+  while (m_slots[slot].address != EMPTY_SLOT && m_slots[slot].address != record.address) {
+    slot = (slot + 1) & (SLOTS - 1);
+  }
+  Candidate& candidate = m_slots[slot];
+  if (candidate.address == EMPTY_SLOT) {
+    if (m_count >= CAPACITY) {
+      m_overflow++;
+      return;
+    }
+    candidate.address = record.address;
+    candidate.windows = 0;
+    candidate.samples = 0;
+    candidate.rssiSum = 0;
+    candidate.rssiSquareSum = 0;
+    m_count++;
+  }
+  candidate.windows |= (uint16_t)(1u << window);
+  if (candidate.samples < 0xFFFF) {
+    candidate.samples++;
+    candidate.rssiSum += record.rssi;
+    candidate.rssiSquareSum += (uint32_t)(record.rssi * record.rssi);
+  }
+}
+
+size_t StationaryLearner::result(Allowlist& list, uint8_t minPercent, uint8_t maxSpreadDb) const {
+  uint32_t minWindows = ((uint32_t)minPercent * WINDOWS + 99) / 100;
+  list.clear();
+  for (size_t i = 0; i < SLOTS; i++) {
+    const Candidate& candidate = m_slots[i];
+    if (candidate.address == EMPTY_SLOT || candidate.samples < 2) {
+      continue;
+    }
+    uint32_t windows = 0;
+    for (uint16_t bits = candidate.windows; bits != 0; bits &= (uint16_t)(bits - 1)) {
+      windows++;
+    }
+    // n^2 * variance = n * sum(x^2) - sum(x)^2, compared without a division or square root
+    int64_t n = candidate.samples;
+    int64_t spread = n * (int64_t)candidate.rssiSquareSum - (int64_t)candidate.rssiSum * candidate.rssiSum;
+    if (windows >= minWindows && spread <= n * n * maxSpreadDb * maxSpreadDb) {
+      list.add(candidate.address);
+    }
+  }
+  return list.size();
+}
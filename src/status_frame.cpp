@@ -0,0 +1,53 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Binary I2C status frame sent to the Teensy
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include "status_frame.h"
+#include "hot_path.h"
+
+// CRC-8 (poly 0x07) of every 4-bit value, two lookups per byte
+static const uint8_t CRC8_NIBBLE[16] = {
+  0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+  0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+uint8_t SCANNER_HOT crc8(const uint8_t* data, size_t length) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    crc = (uint8_t)(crc << 4) ^ CRC8_NIBBLE[crc >> 4];
+    crc = (uint8_t)(crc << 4) ^ CRC8_NIBBLE[crc >> 4];
+  }
+  return crc;
+}
+
+static inline void put16(uint8_t* p, uint16_t value) {
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static inline void put32(uint8_t* p, uint32_t value) {
+  put16(p, (uint16_t)value);
+  put16(p + 2, (uint16_t)(value >> 16));
+}
+
+size_t SCANNER_HOT encodeStatusFrame(const StatusSnapshot& status, uint32_t nowMs, uint8_t* frame) {
+  uint32_t age = nowMs - status.updatedMs;
+  frame[0] = (uint8_t)status.mode;
+  frame[1] = STATUS_FRAME_VERSION;
+  put16(&frame[2], status.count);
+  put16(&frame[4], status.countFootstep);
+  put32(&frame[6], status.sequence);
+  put16(&frame[10], (uint16_t)(age > 0xFFFF ? 0xFFFF : age));
+  put16(&frame[12], status.arrivalRate);
+  put16(&frame[14], status.departureRate);
+  put16(&frame[16], status.meanDwell);
+  frame[STATUS_FRAME_SIZE - 1] = crc8(frame, STATUS_FRAME_SIZE - 1);
+  return STATUS_FRAME_SIZE;
+}
@@ -0,0 +1,122 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Hot path telemetry
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+#include "telemetry.h"
+#include "status_frame.h"
+
+Telemetry telemetry;
+std::atomic<uint8_t> telemetryResetRequest(0);
+
+// Tasks of the BLE stack whose stack headroom is reported (not every version creates all of them)
+#if defined(SCANNER_BACKEND_NIMBLE)
+static const char* BT_TASKS[] = { "nimble_host", "btController" };
+#else
+static const char* BT_TASKS[] = { "BTC_TASK", "BTU_TASK", "btController" };
+#endif
+
+
+static void printStack(Print& out, const char* name, TaskHandle_t task) {
+  if (task != NULL) {
+    out.printf("%-16s %10u bytes stack headroom\n", name, (unsigned)uxTaskGetStackHighWaterMark(task));
+  }
+}
+
+static uint32_t average(const TimingStat& stat) {
+  return (stat.count > 0) ? (uint32_t)(stat.total / stat.count) : 0;
+}
+
+static void put16(uint8_t* p, uint32_t value) {
+  if (value > 0xFFFF) {
+    value = 0xFFFF;
+  }
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t value) {
+  put16(p, value & 0xFFFF);
+  put16(p + 2, value >> 16);
+}
+
+void telemetryEncode(TelemetryFrame& frame) {
+  Telemetry now = telemetry;
+  uint8_t* p = frame.data;
+  p[0] = TELEMETRY_FRAME_VERSION;
+  put16(&p[1], average(now.onResult));
+  put16(&p[3], now.onResult.max);
+  put16(&p[5], average(now.requestEvent));
+  put16(&p[7], average(now.aggregation));
+  put16(&p[9], now.aggregation.max);
+  put16(&p[11], now.advertRate);
+  put32(&p[13], heap_caps_get_free_size(MALLOC_CAP_8BIT));
+  put32(&p[17], heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+  put16(&p[21], now.detection.max);
+  p[23] = crc8(p, TELEMETRY_FRAME_SIZE - 1);
+}
+
+static void printTiming(Print& out, const char* name, const TimingStat& stat, const char* unit) {
+  out.printf("%-16s %10u calls  avg %7u %s  max %7u %s\n", name, (unsigned)stat.count,
+             (unsigned)average(stat), unit, (unsigned)stat.max, unit);
+}
+
+void telemetryPrint(Print& out) {
+  Telemetry now = telemetry;
+  printTiming(out, "onResult", now.onResult, "ns");
+  printTiming(out, "requestEvent", now.requestEvent, "ns");
+  printTiming(out, "aggregation", now.aggregation, "us");
+  printTiming(out, "ledNotification", now.ledNotification, "us");
+  printTiming(out, "scan session", now.scanSession, "ms");
+  printTiming(out, "detection", now.detection, "ms");
+  printTiming(out, "scan recovery", now.scanRecovery, "ms");
+  out.printf("%-16s %10u scan restarts  %u stack reinits\n", "watchdog", (unsigned)now.scanRestarts,
+             (unsigned)now.stackReinits);
+  out.printf("%-16s %10u adverts/s  interval %u ms  window %u ms\n", "scan", (unsigned)now.advertRate,
+             (unsigned)now.scanInterval, (unsigned)now.scanWindow);
+  out.printf("%-16s %10u adverts dropped\n", "filter", (unsigned)now.advertsFiltered);
+
+  out.printf("%-16s %10u bytes free  %u bytes largest block  %u bytes lowest free\n", "heap",
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+  printStack(out, "scan task", now.scanTask);
+  printStack(out, "aggregation task", now.aggregationTask);
+  for (size_t i = 0; i < sizeof(BT_TASKS) / sizeof(BT_TASKS[0]); i++) {
+    printStack(out, BT_TASKS[i], xTaskGetHandle(BT_TASKS[i]));
+  }
+}
+
+void telemetryRequestReset() {
+  telemetryResetRequest.fetch_or(TELEMETRY_OWNERS, std::memory_order_release);
+}
+
+void telemetryReset(uint8_t owner) {
+  TimingStat empty = { 0, 0, 0 };
+  if (owner & TELEMETRY_SCAN_CALLBACK) {
+    telemetry.onResult = empty;
+    telemetry.advertsFiltered = 0;
+  }
+  if (owner & TELEMETRY_I2C) {
+    telemetry.requestEvent = empty;
+  }
+  if (owner & TELEMETRY_SCAN_TASK) {
+    telemetry.scanSession = empty;
+    telemetry.scanRecovery = empty;
+    telemetry.scanRestarts = 0;
+    telemetry.stackReinits = 0;
+  }
+  if (owner & TELEMETRY_AGGREGATION) {
+    telemetry.aggregation = empty;
+    telemetry.ledNotification = empty;
+    telemetry.detection = empty;
+  }
+}
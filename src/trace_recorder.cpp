@@ -0,0 +1,233 @@
+/*
+  Hidden dependency project
+  Copyright (c) 2024 Sangbong Lee <sangbong@me.com>
+
+  * Advert trace recorder (RAM double buffer, LittleFS writer task)
+
+  This work is licensed under the Creative Commons Attribution 4.0 International License.
+  To view a copy of this license, visit http://creativecommons.org/licenses/by/4.0/.
+*/
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <atomic>
+
+#include "log.h"
+#include "advert_trace.h"
+#include "trace_recorder.h"
+#include "hot_path.h"
+
+static const size_t BUFFER_SIZE = 4096;
+static const uint32_t FLUSH_INTERVAL_MS = 2000;   // A partly filled buffer is handed over after this long
+static const char* TRACE_FILES[2] = { "/trace0.blet", "/trace1.blet" };
+
+// Writer task requests
+static const uint32_t REQUEST_FLUSH = 0x01;
+static const uint32_t REQUEST_START = 0x02;
+static const uint32_t REQUEST_STOP = 0x04;
+static const uint32_t REQUEST_DUMP = 0x08;
+
+// Written by the scan callback only while recording
+static uint8_t buffers[2][BUFFER_SIZE];
+static size_t fill[2];
+static uint8_t active = 0;
+static uint32_t bufferStartMs = 0;
+static uint32_t dropped = 0;
+static std::atomic<bool> pending[2];   // Buffer handed over to the writer task
+static std::atomic<bool> recording(false);
+static std::atomic<uint8_t> adding(0);   // Scan callback inside traceRecorderAdd, the stop waits for 0
+static bool withPayload = true;
+
+// Writer task state
+static TaskHandle_t writerTask = NULL;
+static std::atomic<uint32_t> requests(0);
+static File file;
+static int segment = 0;
+static uint32_t segmentMaxBytes = 0;
+static uint32_t records = 0;
+
+static void request(uint32_t bits) {
+  requests.fetch_or(bits);
+  xTaskNotifyGive(writerTask);
+}
+
+static bool openSegment(int index) {
+  uint8_t header[TRACE_HEADER_SIZE];
+  segment = index;
+  file = LittleFS.open(TRACE_FILES[segment], "w");
+  return file && file.write(header, traceWriteHeader(header)) == TRACE_HEADER_SIZE;
+}
+
+static uint32_t countRecords(const uint8_t* data, size_t length) {
+  uint32_t count = 0;
+  TraceRecord record;
+  size_t used;
+  while ((used = traceDecode(data, length, &record)) > 0) {
+    data += used;
+    length -= used;
+    count++;
+  }
+  return count;
+}
+
+// Buffers only hold complete records, so a file never ends in the middle of one
+static void writeBuffer(const uint8_t* data, size_t length) {
+  if (!file || length == 0) {
+    return;
+  }
+  if (file.size() + length > segmentMaxBytes) {
+    file.close();
+    if (!openSegment(segment ^ 1)) {
+      LOG_INFO("Trace : cannot open %s", TRACE_FILES[segment]);
+      return;
+    }
+  }
+  if (file.write(data, length) == length) {
+    records += countRecords(data, length);
+  }
+}
+
+static void flushPending() {
+  for (int i = 0; i < 2; i++) {
+    if (pending[i].load(std::memory_order_acquire)) {
+      writeBuffer(buffers[i], fill[i]);
+      fill[i] = 0;
+      pending[i].store(false, std::memory_order_release);
+    }
+  }
+}
+
+static void dumpFile(const char* path) {
+  File in = LittleFS.open(path, "r");
+  if (!in) {
+    return;
+  }
+  static const char digits[] = "0123456789abcdef";
+  uint8_t data[32];
+  char line[sizeof(data) * 2 + 1];
+  Serial.printf("trace begin %s %u\n", path, (unsigned)in.size());
+  size_t length;
+  while ((length = in.read(data, sizeof(data))) > 0) {
+    for (size_t i = 0; i < length; i++) {
+      line[i * 2] = digits[data[i] >> 4];
+      line[i * 2 + 1] = digits[data[i] & 0x0F];
+    }
+    line[length * 2] = '\0';
+    Serial.println(line);
+  }
+  Serial.println("trace end");
+  in.close();
+}
+
+static void writerLoop(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uint32_t work = requests.exchange(0);
+
+    if (work & REQUEST_START) {
+      LittleFS.remove(TRACE_FILES[1]);
+      if (openSegment(0)) {
+        records = 0;
+        fill[0] = fill[1] = 0;
+        active = 0;
+        dropped = 0;
+        recording.store(true, std::memory_order_release);
+      } else {
+        LOG_INFO("Trace : cannot open %s", TRACE_FILES[0]);
+      }
+    }
+    if (work & REQUEST_FLUSH) {
+      flushPending();
+    }
+    if (work & REQUEST_STOP) {
+      // A scan callback that saw recording still set is counted in adding, wait until it left the buffers
+      while (adding.load(std::memory_order_acquire) != 0) {
+        vTaskDelay(1);
+      }
+      flushPending();
+      writeBuffer(buffers[active], fill[active]);
+      fill[active] = 0;
+      file.close();
+      LOG_INFO("Trace : %u records written, %u dropped", (unsigned)records, (unsigned)dropped);
+    }
+    if (work & REQUEST_DUMP) {
+      // Older file first, so the concatenated dump replays in time order
+      dumpFile(TRACE_FILES[segment ^ 1]);
+      dumpFile(TRACE_FILES[segment]);
+    }
+  }
+}
+
+bool traceRecorderBegin(int core) {
+  if (!LittleFS.begin(true)) {
+    return false;
+  }
+  return xTaskCreatePinnedToCore(writerLoop, "trace", 4096, NULL, 1, &writerTask, core) == pdPASS;
+}
+
+void traceRecorderStart(uint32_t maxBytes, bool payload) {
+  if (writerTask == NULL || recording.load()) {
+    return;
+  }
+  segmentMaxBytes = maxBytes / 2;
+  withPayload = payload;
+  request(REQUEST_START);
+}
+
+void traceRecorderStop() {
+  if (writerTask == NULL || !recording.exchange(false)) {
+    return;
+  }
+  request(REQUEST_STOP);
+}
+
+void traceRecorderDump() {
+  if (writerTask != NULL && !recording.load()) {
+    request(REQUEST_DUMP);
+  }
+}
+
+bool traceRecorderRunning() {
+  return recording.load(std::memory_order_relaxed);
+}
+
+static void SCANNER_HOT append(const ScanResult& result, uint32_t nowMs) {
+  // Hand the buffer over when it may not fit another record or has waited long enough
+  bool full = fill[active] + TRACE_RECORD_MAX > BUFFER_SIZE;
+  if (full || (fill[active] > 0 && nowMs - bufferStartMs >= FLUSH_INTERVAL_MS)) {
+    uint8_t other = active ^ 1;
+    if (!pending[other].load(std::memory_order_acquire)) {
+      pending[active].store(true, std::memory_order_release);
+      active = other;
+      request(REQUEST_FLUSH);
+    } else if (full) {
+      dropped++;   // Writer still busy with the other buffer
+      return;
+    }
+  }
+  if (fill[active] == 0) {
+    bufferStartMs = nowMs;
+  }
+  fill[active] += traceEncode(result, nowMs, withPayload, &buffers[active][fill[active]]);
+}
+
+void SCANNER_HOT traceRecorderAdd(const ScanResult& result, uint32_t nowMs) {
+  if (!recording.load(std::memory_order_relaxed)) {
+    return;
+  }
+  // Sequentially consistent against recording.exchange() in traceRecorderStop(): either the stop sees
+  // adding != 0 or this sees recording cleared and leaves the buffers alone
+  adding.fetch_add(1, std::memory_order_seq_cst);
+  if (recording.load(std::memory_order_seq_cst)) {
+    append(result, nowMs);
+  }
+  adding.fetch_sub(1, std::memory_order_release);
+}
+
+uint32_t traceRecorderRecords() {
+  return records;
+}
+
+uint32_t traceRecorderDropped() {
+  return dropped;
+}